@@ -0,0 +1,401 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <math.h>
+#include <sys/mman.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#include <glib.h>
+#include <igraph.h>
+
+/* ===============================
+   bench_fastgraph: micro-benchmark delle primitive di FastGraph
+   =============================== */
+
+/* Misura fastgraph_has_edge, fastgraph_neighbors, add/remove e neighbor_switch
+   su un grafo sintetico di dimensione, densità e asimmetria dei gradi scelte da
+   riga di comando, riportando ns per operazione, cache miss per operazione
+   (perf_event_open, se il kernel lo consente) e allocazioni per operazione.
+   Le primitive sono static in ibrido.c: il sorgente viene incluso qui sotto
+   (senza main, come in libjdm.a). malloc, calloc, realloc e mmap sono
+   ridefinite prima dell'inclusione per contare le allocazioni di ibrido.c e
+   di jdm_arena.h: il conteggio copre solo le chiamate dirette di quei sorgenti,
+   non quelle fatte dentro glib (GArray, GHashTable, g_new) o igraph, quindi
+   "alloc/op" è un limite inferiore. Un nuovo backend di adiacenza si confronta rilanciando gli
+   stessi carichi (stessi -n -k -g -s) sulle due versioni.
+*/
+static long bench_allocs = 0;
+
+static void *bench_malloc(size_t n) {
+    bench_allocs++;
+    return malloc(n);
+}
+
+static void *bench_calloc(size_t n, size_t size) {
+    bench_allocs++;
+    return calloc(n, size);
+}
+
+static void *bench_realloc(void *p, size_t n) {
+    bench_allocs++;
+    return realloc(p, n);
+}
+
+static void *bench_mmap(void *addr, size_t len, int prot, int flags, int fd, off_t off) {
+    bench_allocs++;
+    return mmap(addr, len, prot, flags, fd, off);
+}
+
+#define malloc(n) bench_malloc(n)
+#define calloc(n, size) bench_calloc(n, size)
+#define realloc(p, n) bench_realloc(p, n)
+#define mmap(addr, len, prot, flags, fd, off) bench_mmap(addr, len, prot, flags, fd, off)
+#ifndef JDM_LIBRARY
+#define JDM_LIBRARY
+#endif
+#include "ibrido.c"
+#undef malloc
+#undef calloc
+#undef realloc
+#undef mmap
+
+/* ---- Generatore e contatori ---- */
+
+/* splitmix64: stesso flusso per lo stesso seme, indipendente da rand() */
+static uint64_t bench_state = 1;
+
+static inline uint64_t bench_next(void) {
+    uint64_t z = (bench_state += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+static inline int bench_below(int n) {
+    return (int) (((bench_next() >> 32) * (uint64_t) n) >> 32);
+}
+
+/* Contatore dei cache miss del processo (solo spazio utente), -1 se non disponibile. */
+static int cache_counter_open(void) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = PERF_COUNT_HW_CACHE_MISSES;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return (int) syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/* ---- Grafo sintetico ---- */
+
+/* Gradi obiettivo: tutti avg_k se gamma == 0, altrimenti power-law con esponente
+   gamma e media avg_k (pesi alla Chung-Lu), limitati a n-1. Ordinati in modo
+   crescente, così ogni grado forma una classe di id consecutivi. */
+static int *bench_degrees(int n, double avg_k, double gamma) {
+    int *degree = malloc(n * sizeof(int));
+    if (!degree) return NULL;
+    double *w = malloc(n * sizeof(double));
+    if (!w) {
+        free(degree);
+        return NULL;
+    }
+    double sum = 0;
+    for (int i = 0; i < n; i++) {
+        w[i] = gamma > 0 ? pow(i + 1.0, -1.0 / (gamma - 1.0)) : 1.0;
+        sum += w[i];
+    }
+    for (int i = 0; i < n; i++) {
+        double d = w[i] * avg_k * n / sum;
+        degree[n - 1 - i] = d < 1 ? 1 : d > n - 1 ? n - 1 : (int) (d + 0.5);
+    }
+    free(w);
+    return degree;
+}
+
+typedef struct {
+    FastGraph g;
+    int *degree;
+    int *residual;
+    DegreeClass *classes;
+    int n_classes;
+    jdm_node_t *eu, *ev; /* archi realizzati, per le query presenti */
+    long n_edges;
+} BenchGraph;
+
+/* Modello di configurazione cancellato: gli stub vengono mescolati e accoppiati,
+   scartando loop e doppioni; una frazione free_frac resta libera, così
+   neighbor_switch trova sempre un w_prime nella classe. */
+static int bench_graph_build(BenchGraph *bg, int n, double avg_k, double gamma, double free_frac) {
+    memset(bg, 0, sizeof(*bg));
+    bg->degree = bench_degrees(n, avg_k, gamma);
+    if (!bg->degree) return 1;
+    long stubs = 0;
+    for (int u = 0; u < n; u++) stubs += bg->degree[u];
+    jdm_node_t *stub = malloc(stubs * sizeof(jdm_node_t));
+    bg->residual = malloc(n * sizeof(int));
+    bg->eu = malloc((stubs / 2 + 1) * sizeof(jdm_node_t));
+    bg->ev = malloc((stubs / 2 + 1) * sizeof(jdm_node_t));
+    bg->classes = malloc(n * sizeof(DegreeClass));
+    if (!stub || !bg->residual || !bg->eu || !bg->ev || !bg->classes
+        || fastgraph_init(&bg->g, n, bg->degree) != 0) {
+        free(stub);
+        return 1;
+    }
+    long s = 0;
+    for (int u = 0; u < n; u++)
+        for (int i = 0; i < bg->degree[u]; i++) stub[s++] = u;
+    for (long i = stubs - 1; i > 0; i--) {
+        long j = (long) (bench_next() % (uint64_t) (i + 1));
+        jdm_node_t t = stub[i];
+        stub[i] = stub[j];
+        stub[j] = t;
+    }
+    long pairs = (long) (stubs / 2 * (1.0 - free_frac));
+    for (long p = 0; p < pairs; p++) {
+        jdm_node_t u = stub[2 * p], v = stub[2 * p + 1];
+        if (u == v || fastgraph_has_edge(&bg->g, u, v)) continue;
+        fastgraph_add_edge(&bg->g, u, v);
+        bg->eu[bg->n_edges] = u;
+        bg->ev[bg->n_edges] = v;
+        bg->n_edges++;
+    }
+    free(stub);
+    for (int u = 0; u < n; u++) {
+        bg->residual[u] = bg->degree[u] - bg->g.adj_len[u];
+        if (u == 0 || bg->degree[u] != bg->degree[u - 1]) {
+            bg->classes[bg->n_classes].degree = bg->degree[u];
+            bg->classes[bg->n_classes].first = u;
+            bg->classes[bg->n_classes].count = 0;
+            bg->n_classes++;
+        }
+        bg->classes[bg->n_classes - 1].count++;
+    }
+    return 0;
+}
+
+static void bench_graph_destroy(BenchGraph *bg) {
+    fastgraph_destroy(&bg->g);
+    free(bg->degree);
+    free(bg->residual);
+    free(bg->eu);
+    free(bg->ev);
+    free(bg->classes);
+}
+
+/* ---- Carichi ---- */
+
+typedef enum {
+    OP_HAS_EDGE_HIT,
+    OP_HAS_EDGE_MISS,
+    OP_NEIGHBORS,
+    OP_REMOVE_ADD,
+    OP_NEIGHBOR_SWITCH,
+    OP_COUNT
+} BenchOp;
+
+static const char *const op_names[] = {
+    "has_edge (presente)", "has_edge (casuale)", "neighbors", "remove+add", "neighbor_switch"
+};
+
+/* Classe di grado del nodo u: i gradi sono ordinati, quindi ricerca binaria. */
+static int bench_class_index(const BenchGraph *bg, jdm_node_t u) {
+    int lo = 0, hi = bg->n_classes - 1;
+    while (lo < hi) {
+        int mid = (lo + hi + 1) / 2;
+        if (bg->classes[mid].first <= u) lo = mid;
+        else hi = mid - 1;
+    }
+    return lo;
+}
+
+/* Argomenti precalcolati, fuori dalla misura: a[i], b[i] per la query i
+   (per neighbor_switch b[i] è la classe di a[i]). */
+static void bench_prepare(const BenchGraph *bg, BenchOp op, jdm_node_t *a, jdm_node_t *b, long q) {
+    int n = (int) bg->g.total_nodes;
+    for (long i = 0; i < q; i++) {
+        if (op == OP_HAS_EDGE_HIT || op == OP_REMOVE_ADD) {
+            long e = (long) (bench_next() % (uint64_t) bg->n_edges);
+            a[i] = bg->eu[e];
+            b[i] = bg->ev[e];
+        } else {
+            a[i] = bench_below(n);
+            b[i] = op == OP_NEIGHBOR_SWITCH ? bench_class_index(bg, a[i]) : bench_below(n);
+        }
+    }
+}
+
+/* Esegue q operazioni; restituisce un valore dipendente dai risultati, perché il
+   compilatore non elimini le chiamate. */
+static long bench_run(BenchGraph *bg, BenchOp op, const jdm_node_t *a, const jdm_node_t *b, long q,
+                      Arena *scratch) {
+    FastGraph *g = &bg->g;
+    long sink = 0;
+    switch (op) {
+    case OP_HAS_EDGE_HIT:
+    case OP_HAS_EDGE_MISS:
+        for (long i = 0; i < q; i++)
+            sink += fastgraph_has_edge(g, a[i], b[i]);
+        break;
+    case OP_NEIGHBORS:
+        for (long i = 0; i < q; i++) {
+            ArenaMark mark = arena_mark(scratch);
+            int n_neigh;
+            jdm_node_t *neighbors = fastgraph_neighbors(g, a[i], &n_neigh, scratch);
+            if (neighbors && n_neigh > 0) sink += neighbors[n_neigh - 1];
+            arena_reset(scratch, mark);
+        }
+        break;
+    case OP_REMOVE_ADD:
+        for (long i = 0; i < q; i++) {
+            fastgraph_remove_edge(g, a[i], b[i]);
+            sink += fastgraph_add_edge(g, a[i], b[i]);
+        }
+        break;
+    case OP_NEIGHBOR_SWITCH:
+        for (long i = 0; i < q; i++) {
+            jdm_node_t w = a[i];
+            if (g->adj_len[w] == 0) continue;
+            neighbor_switch(g, w, &bg->classes[b[i]], bg->residual, NO_AVOID, scratch);
+            sink += bg->residual[w];
+        }
+        break;
+    default:
+        break;
+    }
+    return sink;
+}
+
+static void bench_usage(const char *prog) {
+    fprintf(stderr,
+            "Uso: %s [-n nodi] [-k grado medio] [-g gamma] [-f stub liberi] [-q operazioni]\n"
+            "       [-t secondi] [-r ripetizioni] [-s seme]\n"
+            "  -n nodi        nodi del grafo sintetico (default 100000)\n"
+            "  -k grado medio densità del grafo (default 8)\n"
+            "  -g gamma       esponente power-law dei gradi, 0 = grafo regolare (default 2.5)\n"
+            "  -f frazione    frazione di stub lasciati liberi (default 0.02)\n"
+            "  -q operazioni  operazioni per misura, al massimo (default 1048576)\n"
+            "  -t secondi     durata indicativa di ogni misura (default 0.2)\n"
+            "  -r ripetizioni misure per operazione, si riporta la migliore (default 3)\n"
+            "  -s seme        seme del generatore (default 1)\n",
+            prog);
+}
+
+int main(int argc, char *argv[]) {
+    int n = 100000;
+    double avg_k = 8, gamma = 2.5, free_frac = 0.02;
+    long q = 1 << 20;
+    double budget = 0.2;
+    int reps = 3;
+    unsigned long seed = 1;
+    int c;
+    while ((c = getopt(argc, argv, "n:k:g:f:q:t:r:s:h")) != -1) {
+        switch (c) {
+        case 'n': n = atoi(optarg); break;
+        case 'k': avg_k = atof(optarg); break;
+        case 'g': gamma = atof(optarg); break;
+        case 'f': free_frac = atof(optarg); break;
+        case 'q': q = atol(optarg); break;
+        case 't': budget = atof(optarg); break;
+        case 'r': reps = atoi(optarg); break;
+        case 's': seed = strtoul(optarg, NULL, 10); break;
+        default:  bench_usage(argv[0]); return 1;
+        }
+    }
+    if (n < 2 || avg_k <= 0 || (gamma != 0 && gamma <= 1) || free_frac < 0 || free_frac >= 1
+        || q < 1 || budget <= 0 || reps < 1) {
+        bench_usage(argv[0]);
+        return 1;
+    }
+    bench_state = seed;
+    srand((unsigned) seed);
+
+    BenchGraph bg;
+    double t0 = now_ns();
+    if (bench_graph_build(&bg, n, avg_k, gamma, free_frac) != 0 || bg.n_edges == 0) {
+        fprintf(stderr, "Errore: impossibile costruire il grafo sintetico\n");
+        return 1;
+    }
+    int max_degree = bg.degree[n - 1], hubs = 0;
+    for (int u = 0; u < n; u++) hubs += fastgraph_is_hub(&bg.g, u);
+    printf("Grafo: %d nodi, %ld archi, grado medio %.2f, massimo %d, %d hub (grado > %d), "
+           "%d classi, %zu slot; costruito in %.1f ms\n",
+           n, bg.n_edges, 2.0 * bg.n_edges / n, max_degree, hubs, HUB_DEGREE, bg.n_classes,
+           bg.g.adj_off[n], (now_ns() - t0) / 1e6);
+
+    int perf_fd = cache_counter_open();
+    if (perf_fd < 0)
+        printf("(cache miss non disponibili: perf_event_open non consentito)\n");
+    printf("%-22s %10s %16s %10s %10s\n", "operazione", "ns/op", "cache-miss/op", "alloc/op", "op");
+
+    jdm_node_t *a = malloc(q * sizeof(jdm_node_t));
+    jdm_node_t *b = malloc(q * sizeof(jdm_node_t));
+    if (!a || !b) {
+        fprintf(stderr, "Errore: impossibile allocare %ld query\n", q);
+        return 1;
+    }
+    /* Arena già avviata, come durante la costruzione: arena_reset non libera il blocco */
+    Arena scratch;
+    arena_init(&scratch, 0);
+    arena_alloc(&scratch, 1);
+    long sink = 0;
+    for (int op = 0; op < OP_COUNT; op++) {
+        /* Taratura: le operazioni lente (neighbor_switch su classi grandi) ne
+           eseguono meno, perché ogni misura duri circa budget secondi */
+        long q_op = q < 1024 ? q : 1024;
+        bench_prepare(&bg, (BenchOp) op, a, b, q_op);
+        double start = now_ns();
+        sink += bench_run(&bg, (BenchOp) op, a, b, q_op, &scratch);
+        double per_op = (now_ns() - start) / q_op;
+        q_op = per_op > 0 ? (long) (budget * 1e9 / per_op) : q;
+        if (q_op > q) q_op = q;
+        if (q_op < 1) q_op = 1;
+
+        double best = -1, best_miss = -1;
+        long allocs = 0;
+        for (int r = 0; r < reps; r++) {
+            bench_prepare(&bg, (BenchOp) op, a, b, q_op);
+            long alloc_before = bench_allocs;
+            long long misses = -1;
+            if (perf_fd >= 0) {
+                ioctl(perf_fd, PERF_EVENT_IOC_RESET, 0);
+                ioctl(perf_fd, PERF_EVENT_IOC_ENABLE, 0);
+            }
+            start = now_ns();
+            sink += bench_run(&bg, (BenchOp) op, a, b, q_op, &scratch);
+            double ns = (now_ns() - start) / q_op;
+            if (perf_fd >= 0) {
+                ioctl(perf_fd, PERF_EVENT_IOC_DISABLE, 0);
+                if (read(perf_fd, &misses, sizeof(misses)) != sizeof(misses)) misses = -1;
+            }
+            allocs = bench_allocs - alloc_before;
+            if (best < 0 || ns < best) {
+                best = ns;
+                best_miss = misses >= 0 ? (double) misses / q_op : -1;
+            }
+        }
+        char miss[32];
+        if (best_miss >= 0) snprintf(miss, sizeof(miss), "%.3f", best_miss);
+        else snprintf(miss, sizeof(miss), "n/d");
+        printf("%-22s %10.1f %16s %10.3f %10ld\n", op_names[op], best, miss, (double) allocs / q_op, q_op);
+    }
+    printf("(controllo: %ld)\n", sink);
+
+    if (perf_fd >= 0) close(perf_fd);
+    arena_release(&scratch);
+    free(a);
+    free(b);
+    bench_graph_destroy(&bg);
+    return 0;
+}
@@ -1,22 +1,20 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <math.h>
+#include <unistd.h>
 #include <glib.h>
 #include <igraph.h>
+#include "jdm.h"
+#include "jdm_arena.h"
+#include "jdm_edges.h"
+#include "jdm_csr.h"
 
-typedef GHashTable mapii;       // chiave = (int), valore = (int)
-typedef GHashTable mapi_mapii;  // chiave = (int), valore = (mapii *)
-
-/* Macros per convertire tra int e gpointer */
-#ifndef GINT_TO_POINTER
-#define GINT_TO_POINTER(i)  ((gpointer)(glong)(i))
-#endif
-#ifndef GPOINTER_TO_INT
-#define GPOINTER_TO_INT(p)  ((gint)(glong)(p))
-#endif
+typedef GHashTable mapii;       // chiave = grado, valore = conteggio (JDM_TO_POINTER)
+typedef GHashTable mapi_mapii;  // chiave = grado, valore = (mapii *)
 
 /* --------------------------------------------------------------------
-   load_nkk(filename, nkk)
+   load_nkk_table(filename, nkk)
 
    Legge un file .nkk riga per riga, con formato "k,l,value".
    - k e l sono gradi (interi)
@@ -25,7 +23,7 @@ typedef GHashTable mapi_mapii;  // chiave = (int), valore = (mapii *)
    Riempie la GHashTable 'nkk' così:
      nkk[k][l] = value
    -------------------------------------------------------------------- */
-void load_nkk(const char *filename, mapi_mapii *nkk) {
+static void load_nkk_table(const char *filename, mapi_mapii *nkk) {
     FILE *f = fopen(filename, "r");
     if (!f) {
         fprintf(stderr, "Impossibile aprire il file .nkk: %s\n", filename);
@@ -37,14 +35,15 @@ void load_nkk(const char *filename, mapi_mapii *nkk) {
         char *trim_line = g_strstrip(line);
         if (strlen(trim_line) == 0) continue; // salta righe vuote
 
-        int k, l, val;
-        if (sscanf(trim_line, "%d,%d,%d", &k, &l, &val) == 3) {
-            mapii *inner = g_hash_table_lookup(nkk, GINT_TO_POINTER(k));
+        long long k, l, val;
+        if (sscanf(trim_line, "%lld,%lld,%lld", &k, &l, &val) == 3
+            && k >= 0 && k <= JDM_DEGREE_MAX && l >= 0 && l <= JDM_DEGREE_MAX && val >= 0) {
+            mapii *inner = g_hash_table_lookup(nkk, JDM_TO_POINTER(k));
             if (!inner) {
                 inner = g_hash_table_new(g_direct_hash, g_direct_equal);
-                g_hash_table_insert(nkk, GINT_TO_POINTER(k), inner);
+                g_hash_table_insert(nkk, JDM_TO_POINTER(k), inner);
             }
-            g_hash_table_insert(inner, GINT_TO_POINTER(l), GINT_TO_POINTER(val));
+            g_hash_table_insert(inner, JDM_TO_POINTER(l), JDM_TO_POINTER(val));
         } else {
             fprintf(stderr, "Attenzione: riga non valida in .nkk: %s\n", trim_line);
         }
@@ -60,19 +59,25 @@ void load_nkk(const char *filename, mapi_mapii *nkk) {
    - Crea un grafo igraph con i vertici trovati
    - Aggiunge un edge per ogni riga letta
    (Gestisce o ignora eventuali loop)
+   Un file compresso (jdm_edges.h) è riconosciuto dall'intestazione e
+   decodificato a blocchi in parallelo: non contiene duplicati, quindi gli
+   archi passano direttamente a igraph senza la tabella degli archi unici.
    -------------------------------------------------------------------- */
 
 /* Struttura per memorizzare un arco non diretto (forzando u <= v). */
 typedef struct {
-    int u;
-    int v;
+    jdm_node_t u;
+    jdm_node_t v;
 } UndirectedEdge;
 
 /* Funzione hash per UndirectedEdge. Combina la hash di u e v. */
 static guint edge_hash(gconstpointer key) {
     const UndirectedEdge *e = key;
-    // Metodo semplice: shift di 16 bit di u e XOR con v
-    return (guint) ( (e->u << 16) ^ (e->v & 0xFFFF) );
+    // Tutti i bit di u e v, mescolati (finalizzatore di splitmix64)
+    uint64_t h = (uint64_t) e->u * 0x9e3779b97f4a7c15ull ^ (uint64_t) e->v;
+    h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ull;
+    h = (h ^ (h >> 27)) * 0x94d049bb133111ebull;
+    return (guint) (h ^ (h >> 31));
 }
 
 /* Funzione di eguaglianza per UndirectedEdge. Due edge sono uguali se (u==u && v==v). */
@@ -89,18 +94,34 @@ void build_igraph_from_edgelist(const char *filename, igraph_t *g) {
         exit(EXIT_FAILURE);
     }
 
-    int max_node_id = -1;
+    if (edges_is_compressed(f)) {
+        jdm_node_t *pairs;
+        long n_pairs, n_nodes;
+        long n_threads = sysconf(_SC_NPROCESSORS_ONLN);
+        if (edges_read(f, filename, n_threads > 0 ? (int) n_threads : 1, &pairs, &n_pairs, &n_nodes) != 0)
+            exit(EXIT_FAILURE);
+        fclose(f);
+        igraph_vector_int_t edge_vector;
+        igraph_vector_int_init(&edge_vector, 2 * n_pairs);
+        for (long i = 0; i < 2 * n_pairs; i++)
+            VECTOR(edge_vector)[i] = pairs[i];
+        free(pairs);
+        igraph_empty(g, n_nodes, /*directed=*/0);
+        igraph_add_edges(g, &edge_vector, 0);
+        igraph_vector_int_destroy(&edge_vector);
+        return;
+    }
+
+    jdm_node_t max_node_id = -1;
 
     /* 
        Usiamo una GHashTable<UndirectedEdge, GINT_TO_POINTER(1)> 
        per memorizzare gli archi unici (senza duplicati).
+       Le chiavi stanno in un'arena, liberata in blocco alla fine.
     */
-    GHashTable *edge_set = g_hash_table_new_full(
-        edge_hash,       
-        edge_equal,      
-        g_free,          
-        NULL             
-    );
+    Arena arena;
+    arena_init(&arena, 0);
+    GHashTable *edge_set = g_hash_table_new(edge_hash, edge_equal);
 
     char line[256];
     while (fgets(line, sizeof(line), f)) {
@@ -109,20 +130,29 @@ void build_igraph_from_edgelist(const char *filename, igraph_t *g) {
             continue;  // salta righe vuote
         }
 
-        int u, v;
-        if (sscanf(trim_line, "%d,%d", &u, &v) == 2) {
+        long long u64, v64;
+        if (sscanf(trim_line, "%lld,%lld", &u64, &v64) == 2) {
+            if (u64 < 0 || v64 < 0 || u64 >= JDM_NODE_MAX || v64 >= JDM_NODE_MAX) {
+                fprintf(stderr, "Errore: id di nodo fuori dai limiti in %s: %s\n", filename, trim_line);
+                exit(EXIT_FAILURE);
+            }
+            jdm_node_t u = (jdm_node_t) u64, v = (jdm_node_t) v64;
             if (u > max_node_id) max_node_id = u;
             if (v > max_node_id) max_node_id = v;
 
             // Mettiamo u <= v
             if (v < u) {
-                int temp = u;
+                jdm_node_t temp = u;
                 u = v;
                 v = temp;
             }
 
-            // Creiamo un nuovo UndirectedEdge
-            UndirectedEdge *e = g_new(UndirectedEdge, 1);
+            // Creiamo un nuovo UndirectedEdge (i duplicati restano nell'arena)
+            UndirectedEdge *e = arena_alloc(&arena, sizeof *e);
+            if (!e) {
+                fprintf(stderr, "Errore: memoria esaurita leggendo %s\n", filename);
+                exit(EXIT_FAILURE);
+            }
             e->u = u;
             e->v = v;
 
@@ -143,7 +173,7 @@ void build_igraph_from_edgelist(const char *filename, igraph_t *g) {
     // Scriviamo i nodi degli archi in edge_vector
     GHashTableIter iter;
     gpointer key, value;
-    int idx = 0;
+    long idx = 0;
 
     g_hash_table_iter_init(&iter, edge_set);
     while (g_hash_table_iter_next(&iter, &key, &value)) {
@@ -159,6 +189,7 @@ void build_igraph_from_edgelist(const char *filename, igraph_t *g) {
     // Pulizia
     igraph_vector_int_destroy(&edge_vector);
     g_hash_table_destroy(edge_set);
+    arena_release(&arena);
 }
 
 
@@ -198,22 +229,22 @@ mapi_mapii* compute_jdm_from_igraph(const igraph_t *g) {
         int l = (int) igraph_vector_int_get(&deg, to);
 
         // nkk[k][l]++
-        mapii *mapKL = g_hash_table_lookup(result, GINT_TO_POINTER(k));
+        mapii *mapKL = g_hash_table_lookup(result, JDM_TO_POINTER(k));
         if (!mapKL) {
             mapKL = g_hash_table_new(g_direct_hash, g_direct_equal);
-            g_hash_table_insert(result, GINT_TO_POINTER(k), mapKL);
+            g_hash_table_insert(result, JDM_TO_POINTER(k), mapKL);
         }
-        int old_val_kl = GPOINTER_TO_INT(g_hash_table_lookup(mapKL, GINT_TO_POINTER(l)));
-        g_hash_table_insert(mapKL, GINT_TO_POINTER(l), GINT_TO_POINTER(old_val_kl + 1));
+        intptr_t old_val_kl = JDM_FROM_POINTER(g_hash_table_lookup(mapKL, JDM_TO_POINTER(l)));
+        g_hash_table_insert(mapKL, JDM_TO_POINTER(l), JDM_TO_POINTER(old_val_kl + 1));
 
         // nkk[l][k]++ (simmetria)
-        mapii *mapLK = g_hash_table_lookup(result, GINT_TO_POINTER(l));
+        mapii *mapLK = g_hash_table_lookup(result, JDM_TO_POINTER(l));
         if (!mapLK) {
             mapLK = g_hash_table_new(g_direct_hash, g_direct_equal);
-            g_hash_table_insert(result, GINT_TO_POINTER(l), mapLK);
+            g_hash_table_insert(result, JDM_TO_POINTER(l), mapLK);
         }
-        int old_val_lk = GPOINTER_TO_INT(g_hash_table_lookup(mapLK, GINT_TO_POINTER(k)));
-        g_hash_table_insert(mapLK, GINT_TO_POINTER(k), GINT_TO_POINTER(old_val_lk + 1));
+        intptr_t old_val_lk = JDM_FROM_POINTER(g_hash_table_lookup(mapLK, JDM_TO_POINTER(k)));
+        g_hash_table_insert(mapLK, JDM_TO_POINTER(k), JDM_TO_POINTER(old_val_lk + 1));
 
         IGRAPH_EIT_NEXT(eit);
     }
@@ -223,6 +254,40 @@ mapi_mapii* compute_jdm_from_igraph(const igraph_t *g) {
     return result;
 }
 
+/* --------------------------------------------------------------------
+   compute_jdm_from_csr(g, filename) -> mapi_mapii*
+
+   Come compute_jdm_from_igraph, ma direttamente sul CSR mappato (jdm_csr.h):
+   il grado è la differenza degli offset e ogni arco compare già nelle due
+   direzioni, quindi ogni estremo u -> v incrementa nkk[grado(u)][grado(v)].
+   Ritorna NULL se un vicino non è un nodo valido.
+   -------------------------------------------------------------------- */
+static mapi_mapii *compute_jdm_from_csr(const CsrGraph *g, const char *filename) {
+    mapi_mapii *result = g_hash_table_new(g_direct_hash, g_direct_equal);
+    for (jdm_node_t u = 0; u < g->n_nodes; u++) {
+        int k = csr_degree(g, u);
+        if (k == 0) continue;
+        mapii *row = g_hash_table_lookup(result, JDM_TO_POINTER(k));
+        if (!row) {
+            row = g_hash_table_new(g_direct_hash, g_direct_equal);
+            g_hash_table_insert(result, JDM_TO_POINTER(k), row);
+        }
+        for (uint64_t i = g->off[u]; i < g->off[u + 1]; i++) {
+            jdm_node_t v = g->adj[i];
+            if (v < 0 || v >= g->n_nodes) {
+                fprintf(stderr, "%s: vicino %" PRI_NODE " non valido per il nodo %" PRI_NODE "\n",
+                        filename, v, u);
+                jdm_table_destroy(result);
+                return NULL;
+            }
+            int l = csr_degree(g, v);
+            intptr_t old_val = JDM_FROM_POINTER(g_hash_table_lookup(row, JDM_TO_POINTER(l)));
+            g_hash_table_insert(row, JDM_TO_POINTER(l), JDM_TO_POINTER(old_val + 1));
+        }
+    }
+    return result;
+}
+
 /* --------------------------------------------------------------------
    compare_jdms(nkk_in, nkk_out)
 
@@ -238,9 +303,9 @@ int compare_jdms(mapi_mapii *nkk_in, mapi_mapii *nkk_out) {
     gpointer kkey, kval;
     g_hash_table_iter_init(&outer1, nkk_in);
     while (g_hash_table_iter_next(&outer1, &kkey, &kval)) {
-        int k = GPOINTER_TO_INT(kkey);
+        int k = (int) JDM_FROM_POINTER(kkey);
         mapii *map_in = (mapii *)kval;
-        mapii *map_out = (mapii *)g_hash_table_lookup(nkk_out, GINT_TO_POINTER(k));
+        mapii *map_out = (mapii *)g_hash_table_lookup(nkk_out, JDM_TO_POINTER(k));
         if (!map_out) {
             differences++;
             printf("[Differenza] Nessun valore per k=%d in nkk_out\n", k);
@@ -252,16 +317,16 @@ int compare_jdms(mapi_mapii *nkk_in, mapi_mapii *nkk_out) {
         gpointer lkey1, lval1;
         g_hash_table_iter_init(&inner1, map_in);
         while (g_hash_table_iter_next(&inner1, &lkey1, &lval1)) {
-            int l = GPOINTER_TO_INT(lkey1);
-            int val_in = GPOINTER_TO_INT(lval1);
+            int l = (int) JDM_FROM_POINTER(lkey1);
+            int64_t val_in = JDM_FROM_POINTER(lval1);
 
-            int val_out = 0;
-            gpointer tmp = g_hash_table_lookup(map_out, GINT_TO_POINTER(l));
-            if (tmp) val_out = GPOINTER_TO_INT(tmp);
+            int64_t val_out = 0;
+            gpointer tmp = g_hash_table_lookup(map_out, JDM_TO_POINTER(l));
+            if (tmp) val_out = JDM_FROM_POINTER(tmp);
 
             if (val_in != val_out) {
                 differences++;
-                printf("[Differenza] nkk_in[%d][%d] = %d, nkk_out[%d][%d] = %d\n",
+                printf("[Differenza] nkk_in[%d][%d] = %" PRId64 ", nkk_out[%d][%d] = %" PRId64 "\n",
                        k, l, val_in, k, l, val_out);
             }
         }
@@ -271,9 +336,9 @@ int compare_jdms(mapi_mapii *nkk_in, mapi_mapii *nkk_out) {
     GHashTableIter outer2;
     g_hash_table_iter_init(&outer2, nkk_out);
     while (g_hash_table_iter_next(&outer2, &kkey, &kval)) {
-        int k = GPOINTER_TO_INT(kkey);
+        int k = (int) JDM_FROM_POINTER(kkey);
         mapii *map_out = (mapii *)kval;
-        mapii *map_in = (mapii *)g_hash_table_lookup(nkk_in, GINT_TO_POINTER(k));
+        mapii *map_in = (mapii *)g_hash_table_lookup(nkk_in, JDM_TO_POINTER(k));
 
         // Se k non c'era in nkk_in
         if (!map_in) {
@@ -282,8 +347,8 @@ int compare_jdms(mapi_mapii *nkk_in, mapi_mapii *nkk_out) {
             g_hash_table_iter_init(&inner2, map_out);
             while (g_hash_table_iter_next(&inner2, &lkey2, &lval2)) {
                 differences++;
-                printf("[Differenza] nkk_out[%d][%d] = %d ma k non è presente in nkk_in\n",
-                       k, GPOINTER_TO_INT(lkey2), GPOINTER_TO_INT(lval2));
+                printf("[Differenza] nkk_out[%d][%d] = %" PRId64 " ma k non è presente in nkk_in\n",
+                       k, (int) JDM_FROM_POINTER(lkey2), (int64_t) JDM_FROM_POINTER(lval2));
             }
             continue;
         }
@@ -293,13 +358,13 @@ int compare_jdms(mapi_mapii *nkk_in, mapi_mapii *nkk_out) {
         gpointer lkey2, lval2;
         g_hash_table_iter_init(&inner2, map_out);
         while (g_hash_table_iter_next(&inner2, &lkey2, &lval2)) {
-            int l = GPOINTER_TO_INT(lkey2);
-            int val_out = GPOINTER_TO_INT(lval2);
+            int l = (int) JDM_FROM_POINTER(lkey2);
+            int64_t val_out = JDM_FROM_POINTER(lval2);
 
-            gpointer tmp = g_hash_table_lookup(map_in, GINT_TO_POINTER(l));
+            gpointer tmp = g_hash_table_lookup(map_in, JDM_TO_POINTER(l));
             if (!tmp) {
                 differences++;
-                printf("[Differenza] nkk_out[%d][%d] = %d ma l non è presente in nkk_in\n", 
+                printf("[Differenza] nkk_out[%d][%d] = %" PRId64 " ma l non è presente in nkk_in\n", 
                        k, l, val_out);
             }
         }
@@ -308,29 +373,174 @@ int compare_jdms(mapi_mapii *nkk_in, mapi_mapii *nkk_out) {
     return differences;
 }
 
-int main(int argc, char *argv[]) {
-    if (argc < 3) {
-        fprintf(stderr, "Uso: %s input.nkk generated.graph\n", argv[0]);
+/* --------------------------------------------------------------------
+   write_jdm_stats(path, nkk, n_nodes)
+
+   Statistiche strutturali del grafo ricavate dalla sua JDM, in O(#celle),
+   senza ripassare sugli archi. Con M = somma di nkk (gli estremi, 2 per arco):
+   - n_k = (somma_l nkk[k][l]) / k; i nodi isolati, assenti dalla JDM, sono
+     n_nodes meno la somma degli n_k;
+   - k_nn(k) = somma_l l * nkk[k][l] / somma_l nkk[k][l];
+   - assortatività di grado r: correlazione di Pearson dei gradi ai due capi
+     di un arco, somma nkk (k-mu)(l-mu) / somma nkk (k-mu)^2 con
+     mu = somma k * nkk / M ("nan" se tutti i nodi hanno lo stesso grado).
+   Scrive in path ("-" per stdout) un CSV "statistica,k,valore": prima nodes,
+   edges e assortativity (k vuoto), poi nk, pk e knn per grado crescente.
+   Restituisce 0 se il file è stato scritto.
+   -------------------------------------------------------------------- */
+static int cmp_degree(const void *a, const void *b) {
+    int x = *(const int *) a, y = *(const int *) b;
+    return (x > y) - (x < y);
+}
+
+int write_jdm_stats(const char *path, mapi_mapii *nkk, long n_nodes) {
+    int n_deg = g_hash_table_size(nkk);
+    int *degrees = malloc((n_deg + 1) * sizeof(int));
+    double *row_sum = malloc((n_deg + 1) * sizeof(double));
+    double *row_lsum = malloc((n_deg + 1) * sizeof(double));
+    if (!degrees || !row_sum || !row_lsum) {
+        fprintf(stderr, "Errore: memoria esaurita calcolando le statistiche\n");
+        free(degrees);
+        free(row_sum);
+        free(row_lsum);
+        return 1;
+    }
+    GHashTableIter iter;
+    gpointer key, value;
+    int d = 0;
+    g_hash_table_iter_init(&iter, nkk);
+    while (g_hash_table_iter_next(&iter, &key, &value))
+        degrees[d++] = (int) JDM_FROM_POINTER(key);
+    qsort(degrees, n_deg, sizeof(int), cmp_degree);
+
+    /* Prima passata: somme di riga, totale degli estremi e grado medio per estremo */
+    double arcs = 0, k_sum = 0;
+    for (d = 0; d < n_deg; d++) {
+        mapii *row = g_hash_table_lookup(nkk, JDM_TO_POINTER(degrees[d]));
+        GHashTableIter inner;
+        gpointer lkey, lval;
+        row_sum[d] = row_lsum[d] = 0;
+        g_hash_table_iter_init(&inner, row);
+        while (g_hash_table_iter_next(&inner, &lkey, &lval)) {
+            double val = (double) JDM_FROM_POINTER(lval);
+            row_sum[d] += val;
+            row_lsum[d] += val * (double) JDM_FROM_POINTER(lkey);
+        }
+        arcs += row_sum[d];
+        k_sum += row_sum[d] * degrees[d];
+    }
+    /* Seconda passata: covarianza e varianza centrate sulla media (stabili anche con gradi alti) */
+    double mu = arcs > 0 ? k_sum / arcs : 0, cov = 0, var = 0;
+    for (d = 0; d < n_deg; d++) {
+        mapii *row = g_hash_table_lookup(nkk, JDM_TO_POINTER(degrees[d]));
+        double dk = degrees[d] - mu;
+        GHashTableIter inner;
+        gpointer lkey, lval;
+        g_hash_table_iter_init(&inner, row);
+        while (g_hash_table_iter_next(&inner, &lkey, &lval)) {
+            double val = (double) JDM_FROM_POINTER(lval);
+            cov += val * dk * ((double) JDM_FROM_POINTER(lkey) - mu);
+        }
+        var += row_sum[d] * dk * dk;
+    }
+
+    FILE *fp = strcmp(path, "-") == 0 ? stdout : fopen(path, "w");
+    if (!fp) {
+        perror(path);
+        free(degrees);
+        free(row_sum);
+        free(row_lsum);
+        return 1;
+    }
+    int64_t in_jdm = 0;
+    for (d = 0; d < n_deg; d++)
+        if (degrees[d] > 0) in_jdm += (int64_t) (row_sum[d] / degrees[d]);
+    int64_t isolated = n_nodes > in_jdm ? n_nodes - in_jdm : 0;
+    fprintf(fp, "statistica,k,valore\n");
+    fprintf(fp, "nodes,,%ld\n", n_nodes);
+    fprintf(fp, "edges,,%.0f\n", arcs / 2);
+    fprintf(fp, "assortativity,,%.10g\n", var > 0 ? cov / var : NAN);
+    if (isolated > 0) fprintf(fp, "nk,0,%" PRId64 "\n", isolated);
+    for (d = 0; d < n_deg; d++)
+        if (degrees[d] > 0) fprintf(fp, "nk,%d,%.0f\n", degrees[d], row_sum[d] / degrees[d]);
+    if (isolated > 0 && n_nodes > 0) fprintf(fp, "pk,0,%.10g\n", (double) isolated / n_nodes);
+    for (d = 0; d < n_deg && n_nodes > 0; d++)
+        if (degrees[d] > 0) fprintf(fp, "pk,%d,%.10g\n", degrees[d], row_sum[d] / degrees[d] / n_nodes);
+    for (d = 0; d < n_deg; d++)
+        if (row_sum[d] > 0) fprintf(fp, "knn,%d,%.10g\n", degrees[d], row_lsum[d] / row_sum[d]);
+    int err = ferror(fp);
+    if (fp != stdout) err |= fclose(fp) != 0;
+    else fflush(fp);
+    if (err) fprintf(stderr, "Errore: scrittura di %s non riuscita\n", path);
+    free(degrees);
+    free(row_sum);
+    free(row_lsum);
+    return err ? 1 : 0;
+}
+
+/* --------------------------------------------------------------------
+   jdm_table_destroy(nkk)
+
+   Libera una JDM (mapi_mapii) insieme alle tabelle interne.
+   -------------------------------------------------------------------- */
+void jdm_table_destroy(mapi_mapii *nkk) {
+    GHashTableIter iter;
+    gpointer key, val;
+    g_hash_table_iter_init(&iter, nkk);
+    while (g_hash_table_iter_next(&iter, &key, &val)) {
+        mapii *inner = (mapii *)val;
+        g_hash_table_destroy(inner);
+    }
+    g_hash_table_destroy(nkk);
+}
+
+int compare_jdm_main(int argc, char *argv[]) {
+    const char *stats_file = NULL;
+    int opt;
+    while ((opt = getopt(argc, argv, "t:h")) != -1) {
+        switch (opt) {
+        case 't': stats_file = optarg; break;
+        default:  argc = 0; break;
+        }
+    }
+    if (argc - optind < 2) {
+        fprintf(stderr, "Uso: %s [-t statistiche.csv] input.nkk generated.graph\n"
+                        "  -t file  scrive anche assortatività, distribuzione dei gradi e k_nn(k)\n"
+                        "           del grafo, ricavate dalla sua JDM (\"-\": stdout)\n", argv[0]);
         exit(EXIT_FAILURE);
     }
 
-    const char *nkk_file = argv[1];
-    const char *graph_file = argv[2];
+    const char *nkk_file = argv[optind];
+    const char *graph_file = argv[optind + 1];
 
     /* 1) Carica il JDM di input (nkk_in) */
     mapi_mapii *nkk_in = g_hash_table_new(g_direct_hash, g_direct_equal);
-    load_nkk(nkk_file, nkk_in);
+    load_nkk_table(nkk_file, nkk_in);
     printf("Caricato JDM di input da '%s'\n", nkk_file);
 
-    /* 2) Crea il grafo igraph dall'edgelist generata */
-    igraph_t g;
-    build_igraph_from_edgelist(graph_file, &g);
-    printf("Caricato grafo da '%s'\n", graph_file);
-    printf("Il grafo ha %ld nodi e %ld archi.\n", 
-           (long)igraph_vcount(&g), (long)igraph_ecount(&g));
-
-    /* 3) Calcola il JDM dal grafo (nkk_out) */
-    mapi_mapii *nkk_out = compute_jdm_from_igraph(&g);
+    /* 2-3) Un CSR (jdm_csr.h) si usa dalla mappatura così com'è, senza igraph;
+       un'edge list diventa un grafo igraph da cui si calcola il JDM (nkk_out) */
+    mapi_mapii *nkk_out;
+    long n_nodes;
+    if (csr_file_is_csr(graph_file)) {
+        CsrGraph csr;
+        if (csr_map(graph_file, &csr) != 0) exit(EXIT_FAILURE);
+        printf("Mappato grafo CSR da '%s'\n", graph_file);
+        printf("Il grafo ha %ld nodi e %ld archi.\n", (long) csr.n_nodes, (long) (csr.n_arcs / 2));
+        nkk_out = compute_jdm_from_csr(&csr, graph_file);
+        n_nodes = (long) csr.n_nodes;
+        csr_unmap(&csr);
+        if (!nkk_out) exit(EXIT_FAILURE);
+    } else {
+        igraph_t g;
+        build_igraph_from_edgelist(graph_file, &g);
+        printf("Caricato grafo da '%s'\n", graph_file);
+        printf("Il grafo ha %ld nodi e %ld archi.\n", 
+               (long)igraph_vcount(&g), (long)igraph_ecount(&g));
+        nkk_out = compute_jdm_from_igraph(&g);
+        n_nodes = (long) igraph_vcount(&g);
+        igraph_destroy(&g);
+    }
     printf("JDM calcolata dal grafo caricato.\n");
 
     /* 4) Confronta i due JDM */
@@ -341,32 +551,18 @@ int main(int argc, char *argv[]) {
         printf("[ATTENZIONE] Trovate %d differenze tra la JDM di input e quella calcolata.\n", diff);
     }
 
-    /* 5) Pulizia finale */
-    igraph_destroy(&g);
-
-    // Libera nkk_in
-    {
-        GHashTableIter iter;
-        gpointer key, val;
-        g_hash_table_iter_init(&iter, nkk_in);
-        while (g_hash_table_iter_next(&iter, &key, &val)) {
-            mapii *inner = (mapii *)val;
-            g_hash_table_destroy(inner);
-        }
-        g_hash_table_destroy(nkk_in);
-    }
+    /* 5) Statistiche strutturali dalla JDM del grafo, nella stessa lettura */
+    int err = stats_file ? write_jdm_stats(stats_file, nkk_out, n_nodes) : 0;
 
-    // Libera nkk_out
-    {
-        GHashTableIter iter;
-        gpointer key, val;
-        g_hash_table_iter_init(&iter, nkk_out);
-        while (g_hash_table_iter_next(&iter, &key, &val)) {
-            mapii *inner = (mapii *)val;
-            g_hash_table_destroy(inner);
-        }
-        g_hash_table_destroy(nkk_out);
-    }
+    /* 6) Pulizia finale */
+    jdm_table_destroy(nkk_in);
+    jdm_table_destroy(nkk_out);
+
+    return err;
+}
 
-    return 0;
+#ifndef JDM_LIBRARY
+int main(int argc, char *argv[]) {
+    return compare_jdm_main(argc, argv);
 }
+#endif
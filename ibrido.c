@@ -1,48 +1,132 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
 #include <time.h>
 #include <sys/time.h>
+#include <unistd.h>
 #include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
 #include <math.h>
 #include <glib.h>
-#include <igraph/igraph.h>
+#include <igraph.h>
+#include "jdm.h"
+#include "jdm_arena.h"
+#include "jdm_edges.h"
+#include "jdm_csr.h"
+#include "jdm_io.h"
 
 #define NO_AVOID (-1)
 
+/* Chiave di una cella (k,l) non ordinata, con k <= l. */
+#define CELL_KEY(k, l) \
+    GSIZE_TO_POINTER((k) <= (l) ? ((gsize)(k) << 32) | (gsize)(l) \
+                                : ((gsize)(l) << 32) | (gsize)(k))
+
+/* Intero casuale in [0, n): rand() % n finché n <= RAND_MAX (la stessa sequenza
+   della versione compatta), due estrazioni combinate oltre. */
+static inline jdm_node_t rand_below(jdm_node_t n) {
+#if JDM_INDEX64
+    if (n > RAND_MAX)
+        return (jdm_node_t) ((((uint64_t) rand() << 31) ^ (uint64_t) rand()) % (uint64_t) n);
+#endif
+    return rand() % n;
+}
+
 /* ===============================
    Strutture Dati
    =============================== */
 
-/* FastGraph: struttura per il grafo costruito velocemente utilizzando una matrice di adiacenza.
-   - total_nodes: numero di nodi (0..total_nodes-1)
-   - adj_matrix: matrice di adiacenza (array lineare di dimensione total_nodes*total_nodes)
-         dove adj_matrix[u * total_nodes + v] = 1 significa che esiste l'arco (u,v)
-         e 0 significa che non esiste.
-   - node_residual: array di lunghezza total_nodes che tiene traccia degli stub liberi per ogni nodo
-         (usato solo durante la costruzione).
+/* FastGraph e JdmInput sono dichiarate in jdm.h, condivise con il driver jdm. */
+
+/* Classe di grado: i nodi di grado degree hanno id consecutivi
+   first..first+count-1, quindi la lista dei nodi non va memorizzata.
 */
 typedef struct {
-    int total_nodes;
-    char *adj_matrix;
-    int *node_residual;
-} FastGraph;
+    int degree;
+    jdm_node_t first, count;
+} DegreeClass;
 
 /* ===============================
    1) Funzioni Helper per FastGraph
    =============================== */
 
+/* Adiacenza ibrida: ogni nodo ha uno spazio fisso nel pool g->adj, dimensionato
+   sul grado obiettivo noto all'inizializzazione.
+   - grado <= HUB_DEGREE: array ordinato di capacità pari al grado
+     (sizeof(jdm_node_t) byte per estremo di arco, ricerca binaria);
+   - grado > HUB_DEGREE (hub): tabella a indirizzamento aperto con sondaggio
+     lineare e fattore di carico <= 2/3 (circa 1,5 slot per estremo), slot vuoti = -1.
+   Il tipo di un nodo si ricava dal numero di slot, senza array aggiuntivi.
+*/
+#define HUB_DEGREE 64
+#define ADJ_EMPTY (-1)
+
+static inline long fastgraph_slots(const FastGraph *g, jdm_node_t u) {
+    return (long) (g->adj_off[u + 1] - g->adj_off[u]);
+}
+
+static inline int fastgraph_is_hub(const FastGraph *g, jdm_node_t u) {
+    return fastgraph_slots(g, u) > HUB_DEGREE;
+}
+
+/* Slot iniziale di v nella tabella di un hub con n_slots slot (moltiplicativo + riduzione).
+   n_slots < 2^32 perché il grado è al più JDM_DEGREE_MAX. */
+static inline long hub_home(jdm_node_t v, long n_slots) {
+    return (long) (((uint64_t) ((uint32_t) ((uint64_t) v ^ (uint64_t) v >> 32) * 2654435761u)
+                    * (uint64_t) n_slots) >> 32);
+}
+
 /* Inizializza un FastGraph con n nodi e senza archi.
-   Alloca la matrice di adiacenza (inizializzata a 0).
+   degree[u] è il grado massimo che u raggiungerà (node_residual iniziale): fissa
+   lo spazio del nodo e la sua rappresentazione. Il pool è allocato con huge_calloc
+   (per grafi grandi una mappatura anonima coperta da huge page).
+   g deve essere azzerato ({ 0 }) prima del primo uso. Se contiene già gli array
+   di una costruzione precedente abbastanza grandi, questi vengono riusati senza
+   nuove allocazioni (il demone costruisce così più grafi con gli stessi buffer).
    L'array node_residual verrà impostato esternamente.
 */
-int fastgraph_init(FastGraph *g, int n) {
+int fastgraph_init(FastGraph *g, jdm_node_t n, const int *degree) {
+    g->node_residual = NULL; /* verrà impostato dal chiamante */
+    if (!g->adj_off || g->node_cap < n) {
+        free(g->adj_off);
+        free(g->adj_len);
+        g->adj_off = malloc(((size_t) n + 1) * sizeof(size_t));
+        g->adj_len = malloc(((size_t) n + 1) * sizeof(int));
+        g->node_cap = n;
+        if (!g->adj_off || !g->adj_len) {
+            fprintf(stderr, "Errore: impossibile allocare l'adiacenza per %" PRI_NODE " nodi.\n", n);
+            fastgraph_destroy(g);
+            return 1;
+        }
+    }
     g->total_nodes = n;
-    g->adj_matrix = calloc(n * n, sizeof(char));
-    if (!g->adj_matrix) {
-        fprintf(stderr, "Errore: impossibile allocare la matrice di adiacenza per %d nodi.\n", n);
-        return 1;
+    memset(g->adj_len, 0, ((size_t) n + 1) * sizeof(int));
+    size_t total = 0;
+    for (jdm_node_t u = 0; u < n; u++) {
+        g->adj_off[u] = total;
+        int d = degree[u] > 0 ? degree[u] : 0;
+        total += d > HUB_DEGREE ? (size_t) d + d / 2 + 1 : (size_t) d;
+    }
+    g->adj_off[n] = total;
+    if (!g->adj || g->adj_cap < total) {
+        huge_free(g->adj, g->adj_cap * sizeof(jdm_node_t));
+        g->adj = huge_calloc(total * sizeof(jdm_node_t));
+        g->adj_cap = total;
+        if (!g->adj) {
+            fprintf(stderr, "Errore: impossibile allocare %zu slot di adiacenza.\n", total);
+            fastgraph_destroy(g);
+            return 1;
+        }
+    }
+    for (jdm_node_t u = 0; u < n; u++) {
+        if (fastgraph_is_hub(g, u))
+            memset(g->adj + g->adj_off[u], 0xff, fastgraph_slots(g, u) * sizeof(jdm_node_t));
     }
-    g->node_residual = NULL; /* verrà impostato dal chiamante */
     return 0;
 }
 
@@ -50,126 +134,195 @@ int fastgraph_init(FastGraph *g, int n) {
    (node_residual non viene liberato qui, in quanto gestito altrove)
 */
 void fastgraph_destroy(FastGraph *g) {
-    if (g->adj_matrix) free(g->adj_matrix);
-    g->adj_matrix = NULL;
+    huge_free(g->adj, g->adj_cap * sizeof(jdm_node_t));
+    free(g->adj_off);
+    free(g->adj_len);
+    g->adj = NULL;
+    g->adj_off = NULL;
+    g->adj_len = NULL;
     g->total_nodes = 0;
+    g->node_cap = 0;
+    g->adj_cap = 0;
+}
+
+/* Posizione di v nello spazio di u, o -1 se assente. */
+static inline long fastgraph_find(const FastGraph *g, jdm_node_t u, jdm_node_t v) {
+    const jdm_node_t *a = g->adj + g->adj_off[u];
+    long n_slots = fastgraph_slots(g, u);
+    if (n_slots > HUB_DEGREE) {
+        for (long i = hub_home(v, n_slots); a[i] != ADJ_EMPTY; i = (i + 1 == n_slots) ? 0 : i + 1)
+            if (a[i] == v) return i;
+        return -1;
+    }
+    int lo = 0, hi = g->adj_len[u];
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (a[mid] < v) lo = mid + 1;
+        else hi = mid;
+    }
+    return (lo < g->adj_len[u] && a[lo] == v) ? lo : -1;
+}
+
+/* Verifica se esiste l'arco (u,v): cerca dal lato con lo spazio più piccolo,
+   O(log d) su un array ordinato, O(1) atteso se entrambi sono hub. */
+static inline int fastgraph_has_edge(const FastGraph *g, jdm_node_t u, jdm_node_t v) {
+    if (fastgraph_slots(g, u) > fastgraph_slots(g, v)) {
+        jdm_node_t t = u; u = v; v = t;
+    }
+    return fastgraph_find(g, u, v) >= 0;
+}
+
+static inline int fastgraph_has_room(const FastGraph *g, jdm_node_t u) {
+    /* Un hub tiene sempre almeno uno slot vuoto, che termina le sonde. */
+    long n_slots = fastgraph_slots(g, u);
+    return g->adj_len[u] < (n_slots > HUB_DEGREE ? n_slots - 1 : n_slots);
+}
+
+static inline void fastgraph_insert(FastGraph *g, jdm_node_t u, jdm_node_t v) {
+    jdm_node_t *a = g->adj + g->adj_off[u];
+    long n_slots = fastgraph_slots(g, u);
+    if (n_slots > HUB_DEGREE) {
+        long i = hub_home(v, n_slots);
+        while (a[i] != ADJ_EMPTY) i = (i + 1 == n_slots) ? 0 : i + 1;
+        a[i] = v;
+    } else {
+        int i = g->adj_len[u];
+        while (i > 0 && a[i - 1] > v) {
+            a[i] = a[i - 1];
+            i--;
+        }
+        a[i] = v;
+    }
+    g->adj_len[u]++;
 }
 
-/* Verifica in O(1) se esiste l'arco (u,v). */
-static inline int fastgraph_has_edge(const FastGraph *g, int u, int v) {
-    return g->adj_matrix[u * g->total_nodes + v];
+static inline void fastgraph_erase(FastGraph *g, jdm_node_t u, jdm_node_t v) {
+    long pos = fastgraph_find(g, u, v);
+    if (pos < 0) return;
+    jdm_node_t *a = g->adj + g->adj_off[u];
+    long n_slots = fastgraph_slots(g, u);
+    long i = pos;
+    if (n_slots > HUB_DEGREE) {
+        /* Cancellazione con spostamento all'indietro: nessuna lapide. */
+        long j = i;
+        for (;;) {
+            j = (j + 1 == n_slots) ? 0 : j + 1;
+            if (a[j] == ADJ_EMPTY) break;
+            long h = hub_home(a[j], n_slots);
+            if (i <= j ? (i < h && h <= j) : (i < h || h <= j)) continue;
+            a[i] = a[j];
+            i = j;
+        }
+        a[i] = ADJ_EMPTY;
+    } else {
+        memmove(a + i, a + i + 1, (g->adj_len[u] - i - 1) * sizeof(jdm_node_t));
+    }
+    g->adj_len[u]--;
 }
 
-/* Aggiunge l'arco (u,v) in O(1). */
-static inline void fastgraph_add_edge(FastGraph *g, int u, int v) {
-    g->adj_matrix[u * g->total_nodes + v] = 1;
-    g->adj_matrix[v * g->total_nodes + u] = 1;
+/* Aggiunge l'arco (u,v). Restituisce 0 se l'arco è stato inserito, 1 se è un
+   loop, se c'è già oppure se u o v hanno già raggiunto il grado per cui sono
+   stati dimensionati: il grafo resta invariato e il chiamante non deve contarlo. */
+static inline int fastgraph_add_edge(FastGraph *g, jdm_node_t u, jdm_node_t v) {
+    if (u == v || fastgraph_has_edge(g, u, v)) return 1;
+    if (!fastgraph_has_room(g, u) || !fastgraph_has_room(g, v)) {
+        fprintf(stderr, "Errore: arco (%" PRI_NODE ",%" PRI_NODE ") oltre il grado previsto\n", u, v);
+        return 1;
+    }
+    fastgraph_insert(g, u, v);
+    fastgraph_insert(g, v, u);
+    return 0;
 }
 
-/* Rimuove l'arco (u,v) in O(1). */
-static inline void fastgraph_remove_edge(FastGraph *g, int u, int v) {
-    g->adj_matrix[u * g->total_nodes + v] = 0;
-    g->adj_matrix[v * g->total_nodes + u] = 0;
+/* Rimuove l'arco (u,v). */
+static inline void fastgraph_remove_edge(FastGraph *g, jdm_node_t u, jdm_node_t v) {
+    fastgraph_erase(g, u, v);
+    fastgraph_erase(g, v, u);
 }
 
-/* Ottiene i vicini del nodo u (complessità O(n)).
-   L'array restituito è allocato dinamicamente e va liberato dal chiamante.
+/* Ottiene i vicini del nodo u (complessità O(grado), O(slot) per un hub).
+   L'array restituito è allocato nell'arena scratch: il chiamante lo rilascia
+   con arena_reset su un arena_mark preso prima della chiamata.
    *n_neighbors verrà impostato con il numero di vicini trovati.
 */
-int *fastgraph_neighbors(const FastGraph *g, int u, int *n_neighbors) {
-    int n = g->total_nodes;
-    int count = 0;
-    for (int v = 0; v < n; v++) {
-        if (fastgraph_has_edge(g, u, v) && v != u)
-            count++;
-    }
-    int *neighbors = malloc(count * sizeof(int));
+jdm_node_t *fastgraph_neighbors(const FastGraph *g, jdm_node_t u, int *n_neighbors, Arena *scratch) {
+    int count = g->adj_len[u];
+    jdm_node_t *neighbors = arena_alloc(scratch, count * sizeof(jdm_node_t));
     if (!neighbors) {
         *n_neighbors = 0;
         return NULL;
     }
-    int idx = 0;
-    for (int v = 0; v < n; v++) {
-        if (fastgraph_has_edge(g, u, v) && v != u)
-            neighbors[idx++] = v;
+    const jdm_node_t *a = g->adj + g->adj_off[u];
+    if (fastgraph_is_hub(g, u)) {
+        int idx = 0;
+        for (long i = 0; i < fastgraph_slots(g, u); i++)
+            if (a[i] != ADJ_EMPTY) neighbors[idx++] = a[i];
+    } else {
+        memcpy(neighbors, a, count * sizeof(jdm_node_t));
     }
     *n_neighbors = count;
     return neighbors;
 }
 
+static int cmp_node(const void *a, const void *b) {
+    jdm_node_t x = *(const jdm_node_t *) a, y = *(const jdm_node_t *) b;
+    return (x > y) - (x < y);
+}
+
+/* Vicini di u ordinati per id (per un hub la tabella va ordinata a parte). */
+static jdm_node_t *fastgraph_sorted_neighbors(const FastGraph *g, jdm_node_t u, int *n_neighbors,
+                                              Arena *scratch) {
+    jdm_node_t *neighbors = fastgraph_neighbors(g, u, n_neighbors, scratch);
+    if (neighbors && fastgraph_is_hub(g, u))
+        qsort(neighbors, *n_neighbors, sizeof(jdm_node_t), cmp_node);
+    return neighbors;
+}
+
 /* ===============================
    2) Verifica della Joint Degree
    =============================== */
 
-/* Verifica se la distribuzione di gradi congiunti (nkk) è realizzabile.
-   nkk è una GHashTable<int, GHashTable<int,int>>.
+/* Verifica se la distribuzione di gradi congiunti è realizzabile.
+   Le condizioni 1 (simmetria), 2 (divisibilità) e 5 (diagonale pari) sono già
+   state controllate da load_nkk riga per riga; qui restano le condizioni di
+   capacità 3 e 4, che richiedono nk completo: una sola passata sulle celle.
+   Le capacità nk*nl sono saturate (jdm_mul_sat): con INDEX64 il prodotto può
+   superare 64 bit.
 */
-int is_valid_joint_degree(GHashTable *nkk) {
-    GHashTable *nk = g_hash_table_new(g_direct_hash, g_direct_equal);
-    /* Condizione 2: (somma di nkk[k][l]) / k deve essere intero */
-    {
-        GHashTableIter iter;
-        gpointer key, value;
-        g_hash_table_iter_init(&iter, nkk);
-        while (g_hash_table_iter_next(&iter, &key, &value)) {
-            int k = GPOINTER_TO_INT(key);
-            int s = 0;
-            GHashTable *inner = (GHashTable *) value;
-            GHashTableIter inner_iter;
-            gpointer ikey, ivalue;
-            g_hash_table_iter_init(&inner_iter, inner);
-            while (g_hash_table_iter_next(&inner_iter, &ikey, &ivalue))
-                s += GPOINTER_TO_INT(ivalue);
-            if (k != 0) {
-                if (s % k != 0) {
-                    printf("Violazione della condizione 2\n");
-                    g_hash_table_destroy(nk);
+int is_valid_joint_degree(const JdmInput *in) {
+    GHashTableIter iter;
+    gpointer key, value;
+    g_hash_table_iter_init(&iter, in->nkk);
+    while (g_hash_table_iter_next(&iter, &key, &value)) {
+        int k = (int) JDM_FROM_POINTER(key);
+        int64_t nk_k = JDM_FROM_POINTER(g_hash_table_lookup(in->nk, JDM_TO_POINTER(k)));
+        GHashTable *inner = (GHashTable *) value;
+        GHashTableIter inner_iter;
+        gpointer ikey, ivalue;
+        g_hash_table_iter_init(&inner_iter, inner);
+        while (g_hash_table_iter_next(&inner_iter, &ikey, &ivalue)) {
+            int l = (int) JDM_FROM_POINTER(ikey);
+            int64_t nkk_val = JDM_FROM_POINTER(ivalue);
+            if (k < l) {
+                int64_t nk_l = JDM_FROM_POINTER(g_hash_table_lookup(in->nk, JDM_TO_POINTER(l)));
+                int64_t cap = jdm_mul_sat(nk_k, nk_l);
+                if (nkk_val > cap) {
+                    printf("Violazione della condizione 3 alla riga %d,%d,%" PRId64 ": "
+                           "al massimo %" PRId64 " archi fra %" PRId64 " nodi di grado %d e %" PRId64 " di grado %d\n",
+                           k, l, nkk_val, cap, nk_k, k, nk_l, l);
                     return 0;
                 }
-                g_hash_table_insert(nk, GINT_TO_POINTER(k), GINT_TO_POINTER(s / k));
-            } else {
-                g_hash_table_insert(nk, GINT_TO_POINTER(k), GINT_TO_POINTER(s));
-            }
-        }
-    }
-    /* Condizioni 3, 4, 5 */
-    {
-        GHashTableIter iter;
-        gpointer key, value;
-        g_hash_table_iter_init(&iter, nkk);
-        while (g_hash_table_iter_next(&iter, &key, &value)) {
-            int k = GPOINTER_TO_INT(key);
-            GHashTable *inner = (GHashTable *) value;
-            GHashTableIter inner_iter;
-            gpointer ikey, ivalue;
-            g_hash_table_iter_init(&inner_iter, inner);
-            while (g_hash_table_iter_next(&inner_iter, &ikey, &ivalue)) {
-                int l = GPOINTER_TO_INT(ikey);
-                int nkk_val = GPOINTER_TO_INT(ivalue);
-                int nk_k = GPOINTER_TO_INT(g_hash_table_lookup(nk, GINT_TO_POINTER(k)));
-                int nk_l = GPOINTER_TO_INT(g_hash_table_lookup(nk, GINT_TO_POINTER(l)));
-                if (k != l) {
-                    if (nkk_val > nk_k * nk_l) {
-                        printf("Violazione della condizione 3\n");
-                        g_hash_table_destroy(nk);
-                        return 0;
-                    }
-                } else {
-                    if (nkk_val > nk_k * (nk_k - 1)) {
-                        printf("Violazione della condizione 4\n");
-                        g_hash_table_destroy(nk);
-                        return 0;
-                    }
-                    if (nkk_val % 2 != 0) {
-                        printf("Violazione della condizione 5\n");
-                        g_hash_table_destroy(nk);
-                        return 0;
-                    }
+            } else if (k == l) {
+                int64_t cap = jdm_mul_sat(nk_k, nk_k - 1);
+                if (nkk_val > cap) {
+                    printf("Violazione della condizione 4 alla riga %d,%d,%" PRId64 ": "
+                           "al massimo %" PRId64 " per %" PRId64 " nodi di grado %d\n",
+                           k, l, nkk_val, cap, nk_k, k);
+                    return 0;
                 }
             }
         }
     }
-    g_hash_table_destroy(nk);
     return 1;
 }
 
@@ -177,25 +330,27 @@ int is_valid_joint_degree(GHashTable *nkk) {
    3) neighbor_switch (ottimizzata)
    =============================== */
 /* Libera uno stub dal nodo w effettuando uno scambio di arco.
-   - node_list: GArray* contenente i nodi dello stesso gruppo di grado.
+   - cls: classe di grado di w (nodi cls->first .. cls->first + cls->count - 1).
    - node_residual: array degli stub liberi per ogni nodo.
    - avoid_node_id: se diverso da NO_AVOID, evita quel nodo (se possibile).
+   - scratch: arena per la lista temporanea dei vicini.
+   Restituisce 0 se uno stub di w è stato liberato, 1 se lo scambio non è
+   possibile (il grafo resta invariato).
 */
-void neighbor_switch(FastGraph *g, int w, GArray *node_list, int *node_residual,
-                     int avoid_node_id) {
-    int w_prime = -1;
+int neighbor_switch(FastGraph *g, jdm_node_t w, const DegreeClass *cls, int *node_residual,
+                     jdm_node_t avoid_node_id, Arena *scratch) {
+    jdm_node_t w_prime = -1;
+    jdm_node_t end = cls->first + cls->count;
     /* Passo 1: scegli w_prime con node_residual[w_prime] > 0 */
     if (avoid_node_id == NO_AVOID || node_residual[avoid_node_id] > 1) {
-        for (guint i = 0; i < node_list->len; i++) {
-            int cand = g_array_index(node_list, int, i);
+        for (jdm_node_t cand = cls->first; cand < end; cand++) {
             if (node_residual[cand] > 0) {
                 w_prime = cand;
                 break;
             }
         }
     } else {
-        for (guint i = 0; i < node_list->len; i++) {
-            int cand = g_array_index(node_list, int, i);
+        for (jdm_node_t cand = cls->first; cand < end; cand++) {
             if (cand != avoid_node_id && node_residual[cand] > 0) {
                 w_prime = cand;
                 break;
@@ -203,334 +358,2842 @@ void neighbor_switch(FastGraph *g, int w, GArray *node_list, int *node_residual,
         }
     }
     if (w_prime < 0) {
-        fprintf(stderr, "Errore: neighbor_switch: nessun w_prime trovato per il nodo %d\n", w);
-        return;
+        fprintf(stderr, "Errore: neighbor_switch: nessun w_prime trovato per il nodo %" PRI_NODE "\n", w);
+        return 1;
     }
     /* Passo 2: scegli un vicino t di w che non sia adiacente a w_prime */
     int n_neigh;
-    int *neighbors = fastgraph_neighbors(g, w, &n_neigh);
+    ArenaMark mark = arena_mark(scratch);
+    jdm_node_t *neighbors = fastgraph_neighbors(g, w, &n_neigh, scratch);
     if (!neighbors) {
-        fprintf(stderr, "Errore: neighbor_switch: impossibile ottenere i vicini di w=%d\n", w);
-        return;
+        fprintf(stderr, "Errore: neighbor_switch: impossibile ottenere i vicini di w=%" PRI_NODE "\n", w);
+        return 1;
     }
-    int t = -1;
+    jdm_node_t t = -1;
     for (int i = 0; i < n_neigh; i++) {
-        int cand = neighbors[i];
+        jdm_node_t cand = neighbors[i];
         if (cand == w_prime) continue;
         if (!fastgraph_has_edge(g, w_prime, cand)) {
             t = cand;
             break;
         }
     }
-    free(neighbors);
+    arena_reset(scratch, mark);
     if (t < 0) {
-        fprintf(stderr, "Errore: neighbor_switch: nessun t valido trovato per w=%d\n", w);
-        return;
+        fprintf(stderr, "Errore: neighbor_switch: nessun t valido trovato per w=%" PRI_NODE "\n", w);
+        return 1;
     }
     /* Passo 3: rimuovi (w,t) e aggiungi (w_prime,t) */
     fastgraph_remove_edge(g, w, t);
-    fastgraph_add_edge(g, w_prime, t);
+    if (fastgraph_add_edge(g, w_prime, t) != 0) {
+        fastgraph_add_edge(g, w, t);
+        fprintf(stderr, "Errore: neighbor_switch: impossibile spostare (%" PRI_NODE ",%" PRI_NODE ") su %" PRI_NODE "\n",
+                w, t, w_prime);
+        return 1;
+    }
     /* Passo 4: aggiorna gli stub residui */
     node_residual[w] += 1;
     node_residual[w_prime] -= 1;
+    return 0;
 }
 
 /* ===============================
-   4) joint_degree_model
+   4a) Avanzamento della costruzione
    =============================== */
-/* Costruisce il grafo a partire da nkk utilizzando:
-      - la matrice di adiacenza,
-      - l'array node_residual,
-      - la funzione neighbor_switch,
-      - e accumulando gli archi in un igraph_vector_int_t.
-   Il grafo risultante viene memorizzato in un FastGraph.
+
+/* joint_degree_model pubblica l'avanzamento in un BuildProgress con store
+   relaxed: nel ciclo caldo costano quanto una scrittura normale, senza lock né
+   barriere. Un thread separato (progress_start) li legge a intervalli e stima
+   velocità ed ETA, così una costruzione lenta si distingue da una bloccata
+   (tentativi che crescono senza archi nuovi).
 */
-void joint_degree_model(GHashTable *nkk, FastGraph *g, igraph_vector_int_t *edge_list) {
-    printf("joint_degree_model\n");
-    if (!is_valid_joint_degree(nkk)) {
-        printf("La distribuzione nkk non è realizzabile come grafo semplice.\n");
+#define PROGRESS_SET(field, v) __atomic_store_n(&(field), (v), __ATOMIC_RELAXED)
+#define PROGRESS_GET(field) __atomic_load_n(&(field), __ATOMIC_RELAXED)
+
+static void progress_reset(BuildProgress *p, long edges_total) {
+    PROGRESS_SET(p->edges, 0L);
+    PROGRESS_SET(p->attempts, 0L);
+    PROGRESS_SET(p->switches, 0L);
+    PROGRESS_SET(p->block_cell, 0L);
+    PROGRESS_SET(p->block, 0);
+    PROGRESS_SET(p->n_blocks, 0);
+    PROGRESS_SET(p->edges_total, edges_total);
+}
+
+static inline void progress_block(BuildProgress *p, int b, int k, int l) {
+    PROGRESS_SET(p->block, b);
+    PROGRESS_SET(p->block_cell, (long) k << 32 | (long) l);
+}
+
+struct ProgressReporter {
+    BuildProgress *p;
+    double interval;
+    const char *status_path;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    int stop;
+    struct timeval start;
+};
+
+/* Scrive una riga di avanzamento; prev contiene gli archi e i tentativi della
+   riga precedente e dt i secondi trascorsi da allora. */
+static void progress_report(ProgressReporter *r, long *prev_edges, long *prev_attempts, double dt, int final) {
+    BuildProgress *p = r->p;
+    long total = PROGRESS_GET(p->edges_total);
+    long edges = PROGRESS_GET(p->edges);
+    long attempts = PROGRESS_GET(p->attempts);
+    long switches = PROGRESS_GET(p->switches);
+    long cell = PROGRESS_GET(p->block_cell);
+    int block = PROGRESS_GET(p->block);
+    int n_blocks = PROGRESS_GET(p->n_blocks);
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    double elapsed = ((now.tv_sec - r->start.tv_sec) * 1000000 + (now.tv_usec - r->start.tv_usec)) / 1e6;
+    double rate = dt > 0 ? (edges - *prev_edges) / dt : 0;
+    double attempt_rate = dt > 0 ? (attempts - *prev_attempts) / dt : 0;
+    char eta[64];
+    if (final || edges >= total) snprintf(eta, sizeof(eta), "0 s");
+    else if (rate > 0) snprintf(eta, sizeof(eta), "%.0f s", (total - edges) / rate);
+    else snprintf(eta, sizeof(eta), "? (nessun arco nell'ultimo intervallo)");
+    *prev_edges = edges;
+    *prev_attempts = attempts;
+
+    char line[256];
+    snprintf(line, sizeof(line),
+             "[progresso] %.1f s: archi %ld/%ld (%.1f%%), blocco %d/%d (%d,%d), %.0f archi/s, "
+             "%.0f tentativi/s, switch %ld, ETA %s%s\n",
+             elapsed, edges, total, total > 0 ? 100.0 * edges / total : 0.0, block + (n_blocks > 0),
+             n_blocks, (int) (cell >> 32), (int) (cell & 0xffffffff), rate, attempt_rate, switches, eta,
+             final ? " (fine)" : "");
+    if (!r->status_path) {
+        fputs(line, stderr);
         return;
     }
-    /* Costruisce "nk": per ogni grado k, quanti nodi hanno quel grado. */
-    GHashTable *nk = g_hash_table_new(g_direct_hash, g_direct_equal);
-    {
-        GHashTableIter iter;
-        gpointer key, value;
-        g_hash_table_iter_init(&iter, nkk);
-        while (g_hash_table_iter_next(&iter, &key, &value)) {
-            int k = GPOINTER_TO_INT(key);
-            int s = 0;
-            GHashTable *inner = (GHashTable *) value;
-            GHashTableIter i2;
-            gpointer k2, v2;
-            g_hash_table_iter_init(&i2, inner);
-            while (g_hash_table_iter_next(&i2, &k2, &v2))
-                s += GPOINTER_TO_INT(v2);
-            if (k != 0)
-                g_hash_table_insert(nk, GINT_TO_POINTER(k), GINT_TO_POINTER(s / k));
-            else
-                g_hash_table_insert(nk, GINT_TO_POINTER(k), GINT_TO_POINTER(s));
-        }
+    /* File di stato riscritto per intero: chi lo legge vede sempre una riga completa */
+    char tmp[4096];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", r->status_path);
+    FILE *fp = fopen(tmp, "w");
+    if (!fp) return;
+    fputs(line, fp);
+    if (fclose(fp) == 0) rename(tmp, r->status_path);
+}
+
+static void *progress_thread(void *arg) {
+    ProgressReporter *r = arg;
+    long prev_edges = 0, prev_attempts = 0;
+    struct timeval last = r->start;
+    pthread_mutex_lock(&r->lock);
+    for (;;) {
+        struct timespec until;
+        clock_gettime(CLOCK_REALTIME, &until);
+        long ns = until.tv_nsec + (long) ((r->interval - (long) r->interval) * 1e9);
+        until.tv_sec += (time_t) r->interval + ns / 1000000000L;
+        until.tv_nsec = ns % 1000000000L;
+        while (!r->stop && pthread_cond_timedwait(&r->wake, &r->lock, &until) == 0)
+            ;
+        struct timeval now;
+        gettimeofday(&now, NULL);
+        double dt = ((now.tv_sec - last.tv_sec) * 1000000 + (now.tv_usec - last.tv_usec)) / 1e6;
+        last = now;
+        int final = r->stop;
+        progress_report(r, &prev_edges, &prev_attempts, dt, final);
+        if (final) break;
     }
-    /* Costruisce le liste di nodi per ciascun grado (h_degree_nodelist) e calcola total_nodes. */
-    GHashTable *h_degree_nodelist = g_hash_table_new(g_direct_hash, g_direct_equal);
-    int total_nodes = 0;
-    {
-        GHashTableIter iter;
-        gpointer key, value;
-        g_hash_table_iter_init(&iter, nk);
-        while (g_hash_table_iter_next(&iter, &key, &value)) {
-            int degree = GPOINTER_TO_INT(key);
-            int count  = GPOINTER_TO_INT(value);
-            GArray *arr = g_array_new(FALSE, FALSE, sizeof(int));
-            for (int v = total_nodes; v < total_nodes + count; v++) {
-                g_array_append_val(arr, v);
-            }
-            g_hash_table_insert(h_degree_nodelist, GINT_TO_POINTER(degree), arr);
-            total_nodes += count;
-        }
+    pthread_mutex_unlock(&r->lock);
+    return NULL;
+}
+
+/* Avvia il thread di avanzamento; restituisce NULL (e la costruzione procede
+   senza rapporti) se il thread non può partire. */
+ProgressReporter *progress_start(BuildProgress *p, double interval, const char *status_path) {
+    ProgressReporter *r = calloc(1, sizeof(ProgressReporter));
+    if (!r) return NULL;
+    r->p = p;
+    r->interval = interval > 0 ? interval : 1;
+    r->status_path = status_path;
+    gettimeofday(&r->start, NULL);
+    pthread_mutex_init(&r->lock, NULL);
+    pthread_cond_init(&r->wake, NULL);
+    if (pthread_create(&r->thread, NULL, progress_thread, r) != 0) {
+        perror("pthread_create");
+        pthread_mutex_destroy(&r->lock);
+        pthread_cond_destroy(&r->wake);
+        free(r);
+        return NULL;
     }
-    /* Inizializza il FastGraph con total_nodes. */
-    if (fastgraph_init(g, total_nodes) != 0) {
-        fprintf(stderr, "Errore: impossibile inizializzare il grafo con %d nodi\n", total_nodes);
-        g_hash_table_destroy(nk);
-        g_hash_table_destroy(h_degree_nodelist);
-        return;
+    return r;
+}
+
+/* Ferma il thread dopo un'ultima riga con lo stato finale. */
+void progress_stop(ProgressReporter *r) {
+    if (!r) return;
+    pthread_mutex_lock(&r->lock);
+    r->stop = 1;
+    pthread_cond_signal(&r->wake);
+    pthread_mutex_unlock(&r->lock);
+    pthread_join(r->thread, NULL);
+    pthread_mutex_destroy(&r->lock);
+    pthread_cond_destroy(&r->wake);
+    free(r);
+}
+
+/* ===============================
+   4b) Motore a quote (bucket)
+   =============================== */
+/* Costruzione esatta, senza tentativi casuali (schema di Stanton e Pinar):
+   1. Quote bilanciate: gli stub della classe di grado k sono disposti riga per
+      riga ((k,l1), (k,l2), ...) e assegnati ai nodi della classe a rotazione;
+      ogni nodo riceve esattamente k stub e, in ogni blocco (k,l), floor o ceil
+      di nkk[k][l]/n_k.
+   2. Blocco (k,l) con k != l: i nodi di k, ognuno con stub consecutivi, sono
+      accoppiati ai nodi di l a rotazione partendo dal loro offset di riga.
+      Ogni nodo di l riceve esattamente la propria quota e, poiché
+      ceil(nkk/n_k) <= n_l (condizione 3), i vicini di un nodo sono distinti.
+   3. Blocco (k,k): la sequenza delle quote è quasi regolare, con somma pari
+      (condizione 5) e massimo <= n_k - 1 (condizione 4), quindi grafica; la
+      realizza Havel-Hakimi con le code per residuo (secchi).
+   Ogni input che supera is_valid_joint_degree viene quindi realizzato esattamente,
+   in tempo O(m) più l'ordinamento delle celle. I nodi di ogni classe vengono
+   prima permutati a caso, così grafi diversi escono da semi diversi.
+*/
+
+/* Cella orientata (k,l) della riga k: val stub, a partire dalla posizione off della riga. */
+typedef struct {
+    int k, l;
+    jdm_edge_t val, off;
+} RowCell;
+
+static int cmp_row_cell(const void *a, const void *b) {
+    const RowCell *x = a, *y = b;
+    if (x->k != y->k) return x->k - y->k;
+    return x->l - y->l;
+}
+
+static jdm_edge_t row_cell_offset(const RowCell *cells, int n_cells, int k, int l) {
+    int lo = 0, hi = n_cells;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (cells[mid].k < k || (cells[mid].k == k && cells[mid].l < l)) lo = mid + 1;
+        else hi = mid;
     }
-    /* Alloca l'array node_residual. */
-    int *node_residual = malloc(total_nodes * sizeof(int));
-    if (!node_residual) {
-        fprintf(stderr, "Errore: impossibile allocare l'array node_residual\n");
-        fastgraph_destroy(g);
-        g_hash_table_destroy(nk);
-        g_hash_table_destroy(h_degree_nodelist);
-        return;
+    return cells[lo].off;
+}
+
+/* Destinazione degli archi di un blocco: ctx è il FastGraph con l'edge list
+   in bucket_fill, la parte su file di uno shard in shard_run. 0 se l'arco è accettato. */
+typedef int (*BucketEmit)(void *ctx, jdm_node_t v, jdm_node_t w);
+
+typedef struct {
+    FastGraph *g;
+    igraph_vector_int_t *edge_list;
+} BucketGraph;
+
+static int bucket_add_edge(FastGraph *g, igraph_vector_int_t *edge_list, jdm_node_t v, jdm_node_t w) {
+    if (fastgraph_add_edge(g, v, w) != 0) return 1;
+    igraph_vector_int_push_back(edge_list, v);
+    igraph_vector_int_push_back(edge_list, w);
+    g->node_residual[v]--;
+    g->node_residual[w]--;
+    return 0;
+}
+
+static int bucket_emit_graph(void *ctx, jdm_node_t v, jdm_node_t w) {
+    BucketGraph *bg = ctx;
+    return bucket_add_edge(bg->g, bg->edge_list, v, w);
+}
+
+/* Blocco diagonale: nodi della classe cls con quota q+1 per i primi r a partire
+   da start, q per gli altri; Havel-Hakimi sui residui con liste per valore.
+   perm è indicizzato da cls->first, gli archi vanno a emit(ctx, ...). */
+static jdm_edge_t bucket_fill_diagonal(BucketEmit emit, void *ctx, const jdm_node_t *perm,
+                                       const DegreeClass *cls, jdm_edge_t start, jdm_edge_t stubs, Arena *arena) {
+    jdm_node_t n = cls->count;
+    int q = (int) (stubs / n);             /* quota <= grado (condizione 4) */
+    jdm_node_t r = (jdm_node_t) (stubs % n);
+    jdm_node_t m = q > 0 ? n : r;          /* nodi con quota non nulla */
+    int max_res = q + (r > 0);
+    ArenaMark mark = arena_mark(arena);
+    jdm_node_t *node = arena_alloc(arena, ((size_t) m + 1) * sizeof(jdm_node_t));
+    int *res = arena_alloc(arena, ((size_t) m + 1) * sizeof(int));
+    jdm_node_t *next = arena_alloc(arena, ((size_t) m + 1) * sizeof(jdm_node_t));
+    jdm_node_t *head = arena_alloc(arena, ((size_t) max_res + 1) * sizeof(jdm_node_t));
+    jdm_node_t *chosen = arena_alloc(arena, ((size_t) max_res + 1) * sizeof(jdm_node_t));
+    if (!node || !res || !next || !head || !chosen) {
+        arena_reset(arena, mark);
+        return -1;
     }
-    /* Per ogni nodo, assegna node_residual = grado. */
-    {
-        GHashTableIter iter;
-        gpointer key, value;
-        g_hash_table_iter_init(&iter, h_degree_nodelist);
-        while (g_hash_table_iter_next(&iter, &key, &value)) {
-            int degree = GPOINTER_TO_INT(key);
-            GArray *arr = (GArray *) value;
-            for (guint i = 0; i < arr->len; i++) {
-                int node = g_array_index(arr, int, i);
-                node_residual[node] = degree;
+    for (int x = 0; x <= max_res; x++) head[x] = -1;
+    for (jdm_node_t i = 0; i < m; i++) {
+        node[i] = perm[cls->first + (jdm_node_t) ((start + i) % n)];
+        res[i] = q + (i < r);
+        next[i] = head[res[i]];
+        head[res[i]] = i;
+    }
+    jdm_edge_t added = 0;
+    int top = max_res;
+    for (;;) {
+        while (top > 0 && head[top] < 0) top--;
+        if (top == 0) break;
+        jdm_node_t v = head[top];
+        head[top] = next[v];
+        int need = res[v];
+        res[v] = 0;
+        /* I need nodi con il residuo più alto, raccolti prima di spostarli */
+        int n_chosen = 0;
+        for (int x = top; need > 0; ) {
+            while (x > 0 && head[x] < 0) x--;
+            if (x == 0) {
+                fprintf(stderr, "Errore: motore bucket: blocco (%d,%d) non realizzabile\n",
+                        cls->degree, cls->degree);
+                arena_reset(arena, mark);
+                return -1;
             }
+            jdm_node_t w = head[x];
+            head[x] = next[w];
+            chosen[n_chosen++] = w;
+            need--;
         }
-    }
-    /* Collega l'array node_residual a g per neighbor_switch. */
-    g->node_residual = node_residual;
-    
-    int E = 0;          /* numero di archi aggiunti */
-    int n_switches = 0; /* numero di neighbor switch effettuati */
-    
-    /* Per ogni coppia (k,l) in nkk, aggiunge il numero specificato di archi. */
-    {
-        GHashTableIter outer_iter;
-        gpointer outer_key, outer_value;
-        g_hash_table_iter_init(&outer_iter, nkk);
-        while (g_hash_table_iter_next(&outer_iter, &outer_key, &outer_value)) {
-            int k = GPOINTER_TO_INT(outer_key);
-            GHashTable *inner = (GHashTable *) outer_value;
-            GHashTableIter inner_iter;
-            gpointer inner_key, inner_val;
-            g_hash_table_iter_init(&inner_iter, inner);
-            while (g_hash_table_iter_next(&inner_iter, &inner_key, &inner_val)) {
-                int l = GPOINTER_TO_INT(inner_key);
-                int n_edges_add = GPOINTER_TO_INT(inner_val);
-                if (n_edges_add > 0 && k >= l) {
-                    GArray *k_nodes = g_hash_table_lookup(h_degree_nodelist, GINT_TO_POINTER(k));
-                    GArray *l_nodes = g_hash_table_lookup(h_degree_nodelist, GINT_TO_POINTER(l));
-                    if (!k_nodes || !l_nodes) continue;
-                    int k_size = k_nodes->len;
-                    int l_size = l_nodes->len;
-                    if (k == l)
-                        n_edges_add /= 2;
-                    while (n_edges_add > 0) {
-                        int v = g_array_index(k_nodes, int, rand() % k_size);
-                        int w = g_array_index(l_nodes, int, rand() % l_size);
-                        if (v == w) continue;
-                        if (!fastgraph_has_edge(g, v, w)) {
-                            if (node_residual[v] == 0) {
-                                neighbor_switch(g, v, k_nodes, node_residual, NO_AVOID);
-                                n_switches++;
-                            }
-                            if (node_residual[w] == 0) {
-                                if (k != l)
-                                    neighbor_switch(g, w, l_nodes, node_residual, NO_AVOID);
-                                else
-                                    neighbor_switch(g, w, k_nodes, node_residual, v);
-                                n_switches++;
-                            }
-                            fastgraph_add_edge(g, v, w);
-                            /* Aggiungi l'arco all'edge list igraph (in modalità push_back). */
-                            igraph_vector_int_push_back(edge_list, v);
-                            igraph_vector_int_push_back(edge_list, w);
-                            E++;
-                            node_residual[v]--;
-                            node_residual[w]--;
-                            n_edges_add--;
-                        }
-                    }
-                }
+        for (int c = 0; c < n_chosen; c++) {
+            jdm_node_t w = chosen[c];
+            if (emit(ctx, node[v], node[w]) != 0) {
+                arena_reset(arena, mark);
+                return -1;
+            }
+            added++;
+            if (--res[w] > 0) {
+                next[w] = head[res[w]];
+                head[res[w]] = w;
             }
         }
     }
-    
-    printf("#Switches:%d\n", n_switches);
-    printf("#Edges:%d\n", E);
-    printf("#Nodes:%d\n", total_nodes);
-    
-    free(node_residual);
-    g->node_residual = NULL;
-    g_hash_table_destroy(nk);
-    {
-        GHashTableIter iter;
-        gpointer key, value;
-        g_hash_table_iter_init(&iter, h_degree_nodelist);
-        while (g_hash_table_iter_next(&iter, &key, &value)) {
-            GArray *arr = (GArray *) value;
-            g_array_free(arr, TRUE);
+    arena_reset(arena, mark);
+    return added;
+}
+
+/* Celle orientate non nulle di in, ordinate per (k,l), con l'offset di ogni cella
+   nella propria riga (punto 1 dello schema). NULL se l'arena è esaurita. */
+static RowCell *bucket_cells(const JdmInput *in, int *n_cells_out, Arena *arena) {
+    int n_cells = 0;
+    GHashTableIter iter;
+    gpointer key, value;
+    g_hash_table_iter_init(&iter, in->nkk);
+    while (g_hash_table_iter_next(&iter, &key, &value))
+        n_cells += g_hash_table_size((GHashTable *) value);
+    RowCell *cells = arena_alloc(arena, (n_cells + 1) * sizeof(RowCell));
+    if (!cells) return NULL;
+    int c = 0;
+    g_hash_table_iter_init(&iter, in->nkk);
+    while (g_hash_table_iter_next(&iter, &key, &value)) {
+        GHashTableIter inner_iter;
+        gpointer inner_key, inner_val;
+        g_hash_table_iter_init(&inner_iter, (GHashTable *) value);
+        while (g_hash_table_iter_next(&inner_iter, &inner_key, &inner_val)) {
+            jdm_edge_t val = (jdm_edge_t) JDM_FROM_POINTER(inner_val);
+            if (val <= 0) continue;
+            cells[c].k = (int) JDM_FROM_POINTER(key);
+            cells[c].l = (int) JDM_FROM_POINTER(inner_key);
+            cells[c].val = val;
+            c++;
         }
     }
-    g_hash_table_destroy(h_degree_nodelist);
+    n_cells = c;
+    qsort(cells, n_cells, sizeof(RowCell), cmp_row_cell);
+    for (int i = 0; i < n_cells; i++)
+        cells[i].off = (i > 0 && cells[i - 1].k == cells[i].k) ? cells[i - 1].off + cells[i - 1].val : 0;
+    *n_cells_out = n_cells;
+    return cells;
 }
 
-/* ===============================
-   5) Funzioni di I/O
-   =============================== */
+/* Riempie tutti i blocchi con il motore a quote; restituisce il numero di archi o -1. */
+static jdm_edge_t bucket_fill(const JdmInput *in, FastGraph *g, igraph_vector_int_t *edge_list,
+                              DegreeClass *const *class_of, int max_degree, BuildProgress *pr, Arena *arena) {
+    /* 1) Celle orientate e offset di riga */
+    int n_cells;
+    RowCell *cells = bucket_cells(in, &n_cells, arena);
+    jdm_node_t *perm = arena_alloc(arena, ((size_t) g->total_nodes + 1) * sizeof(jdm_node_t));
+    if (!cells || !perm) return -1;
 
-/* load_nkk:
-   Legge un file con righe "k,l,value" e popola nkk (hash table: k -> (hash table: l->value)).
-*/
-void load_nkk(char *fname, GHashTable *nkk) {
-    FILE *fp = fopen(fname, "r");
-    if (!fp) {
-        fprintf(stderr, "Errore: impossibile aprire il file %s\n", fname);
-        return;
-    }
-    printf("Caricamento file %s\n", fname);
-    char line[1024];
-    while (fgets(line, sizeof(line), fp)) {
-        char *nl = strchr(line, '\n');
-        if (nl) *nl = '\0';
-        int k, l, val;
-        if (sscanf(line, "%d,%d,%d", &k, &l, &val) == 3) {
-            GHashTable *inner = g_hash_table_lookup(nkk, GINT_TO_POINTER(k));
-            if (!inner) {
-                inner = g_hash_table_new(g_direct_hash, g_direct_equal);
-                g_hash_table_insert(nkk, GINT_TO_POINTER(k), inner);
-            }
-            g_hash_table_insert(inner, GINT_TO_POINTER(l), GINT_TO_POINTER(val));
-        } else {
-            printf("Errore nel caricamento della riga: %s\n", line);
+    /* 2) Permutazione casuale dei nodi dentro ogni classe */
+    for (jdm_node_t v = 0; v < g->total_nodes; v++) perm[v] = v;
+    for (int d = 0; d <= max_degree; d++) {
+        const DegreeClass *cls = class_of[d];
+        if (!cls) continue;
+        for (jdm_node_t i = cls->count - 1; i > 0; i--) {
+            jdm_node_t j = rand_below(i + 1);
+            jdm_node_t t = perm[cls->first + i];
+            perm[cls->first + i] = perm[cls->first + j];
+            perm[cls->first + j] = t;
         }
     }
-    printf("  Fatto.\n");
-    fclose(fp);
-}
 
-/* write_graph:
-   Scrive gli archi di g in formato edge list "u,v" per riga.
-   Esegue un doppio ciclo sulla matrice di adiacenza e scrive solo (u,v) con u < v.
-*/
-void write_graph(char *fname, const FastGraph *g) {
-    FILE *fp = fopen(fname, "w");
-    if (!fp) {
-        fprintf(stderr, "Errore: impossibile aprire il file %s per scrittura.\n", fname);
-        return;
-    }
-    printf("Scrittura del file %s.\n", fname);
-    int E = 0;
-    int n = g->total_nodes;
-    for (int u = 0; u < n; u++) {
-        for (int v = u + 1; v < n; v++) {
-            if (fastgraph_has_edge(g, u, v)) {
-                fprintf(fp, "%d,%d\n", u, v);
+    /* 3) Blocchi: ogni coppia non ordinata una sola volta, dalla cella con k >= l */
+    int n_blocks = 0;
+    for (int i = 0; i < n_cells; i++)
+        n_blocks += cells[i].k >= cells[i].l;
+    PROGRESS_SET(pr->n_blocks, n_blocks);
+    BucketGraph bg = { g, edge_list };
+    jdm_edge_t E = 0;
+    int block = 0;
+    for (int i = 0; i < n_cells; i++) {
+        int k = cells[i].k, l = cells[i].l;
+        if (k < l) continue;
+        progress_block(pr, block++, k, l);
+        PROGRESS_SET(pr->edges, (long) E);
+        const DegreeClass *a = k <= max_degree ? class_of[k] : NULL;
+        const DegreeClass *b = l <= max_degree ? class_of[l] : NULL;
+        if (!a || !b) continue;
+        if (k == l) {
+            jdm_edge_t added = bucket_fill_diagonal(bucket_emit_graph, &bg, perm, a, cells[i].off, cells[i].val, arena);
+            if (added < 0) return -1;
+            E += added;
+            continue;
+        }
+        jdm_edge_t e = cells[i].val;
+        jdm_edge_t start_a = cells[i].off;
+        jdm_edge_t start_b = row_cell_offset(cells, n_cells, l, k);
+        jdm_node_t na = a->count, nb = b->count;
+        int qa = (int) (e / na);
+        jdm_node_t ra = (jdm_node_t) (e % na);
+        jdm_edge_t j = 0;
+        for (jdm_node_t x = 0; x < (qa > 0 ? na : ra); x++) {
+            jdm_node_t v = perm[a->first + (jdm_node_t) ((start_a + x) % na)];
+            for (int t = qa + (x < ra); t > 0; t--, j++) {
+                jdm_node_t w = perm[b->first + (jdm_node_t) ((start_b + j) % nb)];
+                if (bucket_add_edge(g, edge_list, v, w) != 0) return -1;
                 E++;
             }
         }
     }
-    fclose(fp);
-    printf("%d archi. Fatto.\n", E);
+    PROGRESS_SET(pr->edges, (long) E);
+    return E;
 }
 
 /* ===============================
-   6) Conversione in igraph (Ibrida)
+   4) joint_degree_model
    =============================== */
-/* Converte il FastGraph (costruito velocemente) in un grafo igraph.
-   Qui utilizziamo l'edge list accumulata nell'igraph_vector_int_t.
+
+/* Blocco (k,l), k >= l, da riempire con edges archi (la diagonale è già dimezzata).
+   key è la chiave dell'ordinamento, switches i neighbor_switch spesi nel blocco.
 */
-void convert_to_igraph(const FastGraph *g, igraph_t *igraph_graph, const igraph_vector_int_t *edge_list) {
-    int n = g->total_nodes;
-    /* Usa igraph_create per creare il grafo in un'unica chiamata */
-    if (igraph_create(igraph_graph, edge_list, n, IGRAPH_UNDIRECTED) != IGRAPH_SUCCESS) {
-        fprintf(stderr, "Errore: igraph_create fallita.\n");
-        return;
-    }
-}
+typedef struct {
+    int k, l;
+    jdm_edge_t edges;
+    jdm_edge_t switches;
+    double key;
+} FillBlock;
 
-/* ===============================
-   7) Funzione main
-   =============================== */
+static const char *const block_order_names[] = { "hash", "degree", "density", "ascending" };
 
-int main(int argc, char *argv[]) {
-    srand((unsigned) time(NULL));
-    if (argc < 2) {
-        fprintf(stderr, "Uso: %s <file.nkk>\n", argv[0]);
-        return 1;
-    }
-    char *fname = argv[1];
+const char *block_order_name(BlockOrder order) {
+    return block_order_names[order];
+}
 
-    /* Crea la distribuzione dei gradi congiunti nkk come una GHashTable. */
-    GHashTable *nkk = g_hash_table_new(g_direct_hash, g_direct_equal);
-    load_nkk(fname, nkk);
+/* Converte il nome di un motore di costruzione (opzione -e); restituisce 0 se valido. */
+int parse_build_engine(const char *name, BuildEngine *engine) {
+    if (strcmp(name, "sampling") == 0) *engine = ENGINE_SAMPLING;
+    else if (strcmp(name, "bucket") == 0) *engine = ENGINE_BUCKET;
+    else return 1;
+    return 0;
+}
 
-    printf("Esecuzione della costruzione\n");
-    struct timeval tp1, tp2;
-    gettimeofday(&tp1, NULL);
+/* Converte il nome di un ordinamento (opzione -o); restituisce 0 se valido. */
+int parse_block_order(const char *name, BlockOrder *order) {
+    for (int i = 0; i < (int) (sizeof(block_order_names) / sizeof(block_order_names[0])); i++) {
+        if (strcmp(name, block_order_names[i]) == 0) {
+            *order = (BlockOrder) i;
+            return 0;
+        }
+    }
+    return 1;
+}
 
-    /* Prepara l'edge list igraph: si stima (o si lascia espandere) la capacità dinamica */
-    igraph_vector_int_t edge_list;
-    igraph_vector_int_init(&edge_list, 0);  // inizialmente vuoto
+/* Chiave decrescente, poi (k,l) crescente: a parità l'ordine è riproducibile. */
+static int cmp_block(const void *a, const void *b) {
+    const FillBlock *x = a, *y = b;
+    if (x->key != y->key) return x->key < y->key ? 1 : -1;
+    if (x->k != y->k) return x->k - y->k;
+    return x->l - y->l;
+}
 
-    /* Costruisce il grafo e accumula gli archi in edge_list */
-    FastGraph fast_g;
-    fast_g.total_nodes = 0;
-    fast_g.adj_matrix = NULL;
-    fast_g.node_residual = NULL;
-    joint_degree_model(nkk, &fast_g, &edge_list);
+static int cmp_block_switches(const void *a, const void *b) {
+    const FillBlock *x = a, *y = b;
+    if (x->switches != y->switches) return x->switches < y->switches ? 1 : -1;
+    return cmp_block(a, b);
+}
 
-    gettimeofday(&tp2, NULL);
-    double runtime = ((tp2.tv_sec - tp1.tv_sec) * 1000000 + (tp2.tv_usec - tp1.tv_usec)) / 1e6;
-    printf("Tempo:%.3f secondi\n", runtime);
+/* Raccoglie i blocchi da riempire e li ordina:
+   - hash: ordine di iterazione delle tabelle (comportamento storico);
+   - degree: prima i blocchi con il grado massimo più alto (gli hub si
+     saturano quando hanno ancora molti partner liberi);
+   - density: prima i blocchi più vincolati, cioè con il rapporto più alto fra
+     archi richiesti e coppie disponibili nk*nl (nk*(nk-1)/2 sulla diagonale);
+   - ascending: prima i gradi bassi, come riferimento opposto a degree.
+*/
+static FillBlock *collect_blocks(const JdmInput *in, BlockOrder order, int *n_blocks, Arena *arena) {
+    int cap = 0;
+    GHashTableIter iter;
+    gpointer key, value;
+    g_hash_table_iter_init(&iter, in->nkk);
+    while (g_hash_table_iter_next(&iter, &key, &value))
+        cap += g_hash_table_size((GHashTable *) value);
+    FillBlock *blocks = arena_alloc(arena, (cap + 1) * sizeof(FillBlock));
+    if (!blocks) return NULL;
 
-    /* Converte il FastGraph in un grafo igraph usando l'edge list accumulata */
-    igraph_t ig_graph;
-    convert_to_igraph(&fast_g, &ig_graph, &edge_list);
-    printf("Grafo igraph creato con %d nodi.\n", (int)igraph_vcount(&ig_graph));
+    int n = 0;
+    g_hash_table_iter_init(&iter, in->nkk);
+    while (g_hash_table_iter_next(&iter, &key, &value)) {
+        int k = (int) JDM_FROM_POINTER(key);
+        GHashTableIter inner_iter;
+        gpointer inner_key, inner_val;
+        g_hash_table_iter_init(&inner_iter, (GHashTable *) value);
+        while (g_hash_table_iter_next(&inner_iter, &inner_key, &inner_val)) {
+            int l = (int) JDM_FROM_POINTER(inner_key);
+            jdm_edge_t val = (jdm_edge_t) JDM_FROM_POINTER(inner_val);
+            if (val <= 0 || k < l) continue;
+            FillBlock *b = &blocks[n++];
+            b->k = k;
+            b->l = l;
+            b->edges = (k == l) ? val / 2 : val;
+            b->switches = 0;
+            double nk = JDM_FROM_POINTER(g_hash_table_lookup(in->nk, JDM_TO_POINTER(k)));
+            double nl = JDM_FROM_POINTER(g_hash_table_lookup(in->nk, JDM_TO_POINTER(l)));
+            double pairs = (k == l) ? nk * (nk - 1) / 2 : nk * nl;
+            switch (order) {
+            case ORDER_DEGREE:    b->key = (double) k * (1 << 20) + l; break;
+            case ORDER_DENSITY:   b->key = pairs > 0 ? b->edges / pairs : 0; break;
+            case ORDER_ASCENDING: b->key = -((double) k * (1 << 20) + l); break;
+            default:              b->key = 0; break;
+            }
+        }
+    }
+    if (order != ORDER_HASH)
+        qsort(blocks, n, sizeof(FillBlock), cmp_block);
+    *n_blocks = n;
+    return blocks;
+}
 
-    /* Scrive il grafo su file in formato edge list. */
-    write_graph("generated.graph", &fast_g);
-    printf("Grafo 'generated.graph' generato in formato edge list\n");
+/* Stampa i blocchi che hanno richiesto più neighbor_switch. */
+#define REPORT_TOP_BLOCKS 5
 
-    /* Pulizia finale. */
-    fastgraph_destroy(&fast_g);
-    igraph_vector_int_destroy(&edge_list);
+static void report_block_switches(FillBlock *blocks, int n_blocks) {
+    qsort(blocks, n_blocks, sizeof(FillBlock), cmp_block_switches);
+    for (int b = 0; b < n_blocks && b < REPORT_TOP_BLOCKS && blocks[b].switches > 0; b++)
+        printf("  blocco (%d,%d): %" PRI_EDGE " switch su %" PRI_EDGE " archi\n",
+               blocks[b].k, blocks[b].l, blocks[b].switches, blocks[b].edges);
+}
+/* Costruisce il grafo a partire dalla JDM caricata utilizzando:
+      - l'adiacenza ibrida del FastGraph,
+      - l'array node_residual,
+      - la funzione neighbor_switch,
+      - e accumulando gli archi in un igraph_vector_int_t.
+   nk e total_nodes arrivano già calcolati da load_nkk; opt->order sceglie
+   l'ordine in cui vengono riempiti i blocchi (k,l) (NULL: ordine delle tabelle).
+   Con opt->engine == ENGINE_BUCKET i blocchi vengono invece riempiti dal
+   motore a quote (bucket_fill), senza campionamento né neighbor_switch.
+   opt->progress, se presente, riceve l'avanzamento (sezione 4a).
+   Il grafo risultante viene memorizzato in un FastGraph.
+   Restituisce 0 se il grafo realizza esattamente la JDM, 1 se la JDM non è
+   valida o se un arco non ha potuto essere piazzato.
+*/
+int joint_degree_model(const JdmInput *in, const BuildOptions *opt, FastGraph *g,
+                        igraph_vector_int_t *edge_list) {
+    printf("joint_degree_model\n");
+    /* Senza lettore l'avanzamento va in una copia locale: il ciclo non ha rami in più */
+    BuildProgress local_progress;
+    BuildProgress *pr = opt && opt->progress ? opt->progress : &local_progress;
+    progress_reset(pr, in->total_edges);
+    /* g può arrivare da una costruzione precedente (worker del demone): se si
+       fallisce prima di fastgraph_init deve risultare vuoto, non il grafo vecchio */
+    g->total_nodes = 0;
+    if (!is_valid_joint_degree(in)) {
+        printf("La distribuzione nkk non è realizzabile come grafo semplice.\n");
+        return 1;
+    }
+    /* Memoria di lavoro della costruzione: rilasciata in blocco alla fine. */
+    Arena arena;
+    arena_init(&arena, 0);
+    jdm_node_t total_nodes = in->total_nodes;
+    /* Classi di grado con id consecutivi e indice diretto grado -> classe. */
+    int n_classes = g_hash_table_size(in->nk);
+    int max_degree = 0;
+    DegreeClass *classes = arena_alloc(&arena, (n_classes + 1) * sizeof(DegreeClass));
     {
         GHashTableIter iter;
         gpointer key, value;
-        g_hash_table_iter_init(&iter, nkk);
-        while (g_hash_table_iter_next(&iter, &key, &value)) {
-            GHashTable *inner = (GHashTable *) value;
-            g_hash_table_destroy(inner);
+        jdm_node_t first = 0;
+        int c = 0;
+        g_hash_table_iter_init(&iter, in->nk);
+        while (classes && g_hash_table_iter_next(&iter, &key, &value)) {
+            classes[c].degree = (int) JDM_FROM_POINTER(key);
+            classes[c].first = first;
+            classes[c].count = (jdm_node_t) JDM_FROM_POINTER(value);
+            if (classes[c].degree > max_degree) max_degree = classes[c].degree;
+            first += classes[c].count;
+            c++;
         }
     }
-    g_hash_table_destroy(nkk);
+    DegreeClass **class_of = arena_calloc(&arena, max_degree + 1, sizeof(DegreeClass *));
+    /* Alloca l'array node_residual. */
+    int *node_residual = arena_alloc(&arena, ((size_t) total_nodes + 1) * sizeof(int));
+    if (!classes || !class_of || !node_residual) {
+        fprintf(stderr, "Errore: impossibile allocare le classi di grado e l'array node_residual\n");
+        arena_release(&arena);
+        return 1;
+    }
+    /* Per ogni nodo, assegna node_residual = grado. */
+    for (int c = 0; c < n_classes; c++) {
+        class_of[classes[c].degree] = &classes[c];
+        for (jdm_node_t v = classes[c].first; v < classes[c].first + classes[c].count; v++)
+            node_residual[v] = classes[c].degree;
+    }
+    /* Inizializza il FastGraph: lo spazio di ogni nodo è dimensionato sul suo grado. */
+    if (fastgraph_init(g, total_nodes, node_residual) != 0) {
+        fprintf(stderr, "Errore: impossibile inizializzare il grafo con %" PRI_NODE " nodi\n", total_nodes);
+        arena_release(&arena);
+        return 1;
+    }
+    /* Collega l'array node_residual a g per neighbor_switch. */
+    g->node_residual = node_residual;
 
-    igraph_destroy(&ig_graph);
+    if (opt && opt->engine == ENGINE_BUCKET) {
+        jdm_edge_t E = bucket_fill(in, g, edge_list, class_of, max_degree, pr, &arena);
+        if (E < 0)
+            fprintf(stderr, "Errore: il motore bucket non ha completato la costruzione\n");
+        printf("#Motore:bucket\n");
+        printf("#Edges:%" PRI_EDGE "\n", E);
+        printf("#Nodes:%" PRI_NODE "\n", total_nodes);
+        g->node_residual = NULL;
+        arena_release(&arena);
+        return E < 0;
+    }
 
-    return 0;
+    jdm_edge_t E = 0;          /* numero di archi aggiunti */
+    jdm_edge_t n_switches = 0; /* numero di neighbor switch effettuati */
+    int failed = 0;
+
+    /* Blocchi (k,l) con k >= l da riempire, nell'ordine scelto da opt->order. */
+    int n_blocks = 0;
+    FillBlock *blocks = collect_blocks(in, opt ? opt->order : ORDER_HASH, &n_blocks, &arena);
+    if (!blocks) {
+        fprintf(stderr, "Errore: impossibile allocare la lista dei blocchi\n");
+        fastgraph_destroy(g);
+        arena_release(&arena);
+        return 1;
+    }
+
+    /* Per ogni blocco (k,l), aggiunge il numero specificato di archi. */
+    PROGRESS_SET(pr->n_blocks, n_blocks);
+    long attempts = 0;
+    for (int b = 0; b < n_blocks && !failed; b++) {
+        int k = blocks[b].k;
+        int l = blocks[b].l;
+        progress_block(pr, b, k, l);
+        jdm_edge_t n_edges_add = blocks[b].edges;
+        const DegreeClass *k_nodes = k <= max_degree ? class_of[k] : NULL;
+        const DegreeClass *l_nodes = l <= max_degree ? class_of[l] : NULL;
+        if (!k_nodes || !l_nodes) continue;
+        jdm_node_t k_size = k_nodes->count;
+        jdm_node_t l_size = l_nodes->count;
+        jdm_edge_t switches_before = n_switches;
+        while (n_edges_add > 0) {
+            PROGRESS_SET(pr->attempts, ++attempts);
+            jdm_node_t v = k_nodes->first + rand_below(k_size);
+            jdm_node_t w = l_nodes->first + rand_below(l_size);
+            if (v == w) continue;
+            if (!fastgraph_has_edge(g, v, w)) {
+                if (node_residual[v] == 0) {
+                    failed = neighbor_switch(g, v, k_nodes, node_residual, NO_AVOID, &arena);
+                    n_switches++;
+                    PROGRESS_SET(pr->switches, (long) n_switches);
+                }
+                if (!failed && node_residual[w] == 0) {
+                    if (k != l)
+                        failed = neighbor_switch(g, w, l_nodes, node_residual, NO_AVOID, &arena);
+                    else
+                        failed = neighbor_switch(g, w, k_nodes, node_residual, v, &arena);
+                    n_switches++;
+                    PROGRESS_SET(pr->switches, (long) n_switches);
+                }
+                /* Un arco che non si può piazzare rende il grafo diverso dalla JDM:
+                   la costruzione fallisce invece di perderlo */
+                if (failed || fastgraph_add_edge(g, v, w) != 0) {
+                    failed = 1;
+                    fprintf(stderr, "Errore: impossibile aggiungere l'arco (%" PRI_NODE ",%" PRI_NODE ") "
+                                    "del blocco (%d,%d)\n", v, w, k, l);
+                    break;
+                }
+                /* Aggiungi l'arco all'edge list igraph (in modalità push_back). */
+                igraph_vector_int_push_back(edge_list, v);
+                igraph_vector_int_push_back(edge_list, w);
+                E++;
+                PROGRESS_SET(pr->edges, (long) E);
+                node_residual[v]--;
+                node_residual[w]--;
+                n_edges_add--;
+            }
+        }
+        blocks[b].switches = n_switches - switches_before;
+    }
+
+    printf("#Ordine:%s\n", block_order_name(opt ? opt->order : ORDER_HASH));
+    printf("#Switches:%" PRI_EDGE "\n", n_switches);
+    printf("#Edges:%" PRI_EDGE "\n", E);
+    printf("#Nodes:%" PRI_NODE "\n", total_nodes);
+    report_block_switches(blocks, n_blocks);
+    if (failed)
+        fprintf(stderr, "Errore: costruzione interrotta, %" PRI_EDGE " archi su %" PRI_EDGE "\n",
+                E, in->total_edges);
+
+    g->node_residual = NULL;
+    arena_release(&arena);
+    return failed;
+}
+
+/* ===============================
+   5) Funzioni di I/O
+   =============================== */
+
+/* jdm_input_finish:
+   Condizione 2: la somma della riga di grado k deve essere divisibile per k.
+   In ingresso in->nk contiene le somme di riga; in uscita il numero di nodi
+   per grado, e total_nodes la loro somma. src identifica la JDM nei messaggi.
+   Il numero di nodi deve stare in jdm_node_t (JDM_NODE_MAX).
+*/
+static int jdm_input_finish(JdmInput *in, const char *src) {
+    GHashTableIter iter;
+    gpointer key, value;
+    int64_t total_nodes = 0;
+    g_hash_table_iter_init(&iter, in->nk);
+    while (g_hash_table_iter_next(&iter, &key, &value)) {
+        int k = (int) JDM_FROM_POINTER(key);
+        jdm_edge_t s = (jdm_edge_t) JDM_FROM_POINTER(value);
+        if (s % k != 0) {
+            fprintf(stderr, "%s: violazione della condizione 2: la riga di grado %d somma a %" PRI_EDGE ", "
+                            "non divisibile per %d\n", src, k, s, k);
+            return 1;
+        }
+        if (jdm_add_checked(&total_nodes, s / k, JDM_NODE_MAX)) {
+            fprintf(stderr, "%s: più di %" PRI_NODE " nodi: ricompilare con INDEX64=1\n", src,
+                    (jdm_node_t) JDM_NODE_MAX);
+            return 1;
+        }
+        g_hash_table_insert(in->nk, key, JDM_TO_POINTER(s / k));
+    }
+    in->total_nodes = (jdm_node_t) total_nodes;
+    printf("  Fatto: %" PRI_NODE " nodi, %" PRI_EDGE " archi, %u gradi.\n",
+           in->total_nodes, in->total_edges, g_hash_table_size(in->nk));
+    return 0;
+}
+
+/* JDM binaria: "JDMB", un uint32 con il numero di celle e per ogni cella tre
+   int32 (k, l, valore), tutto little endian. Le celle seguono la stessa
+   convenzione delle righe di testo e vengono validate allo stesso modo.
+*/
+#define NKK_BINARY_MAGIC "JDMB"
+
+static inline uint32_t read_le32(const unsigned char *p) {
+    return (uint32_t) p[0] | (uint32_t) p[1] << 8 | (uint32_t) p[2] << 16 | (uint32_t) p[3] << 24;
+}
+
+/* nkk_add_row:
+   Valida e inserisce la cella (k,l) = val, letta alla riga lineno di src.
+   pending raccoglie le celle con k != l di cui non è ancora arrivata la
+   simmetrica (chiave -> riga). I valori arrivano a 64 bit: gradi oltre
+   JDM_DEGREE_MAX, valori, somme di riga e archi oltre JDM_EDGE_MAX vengono
+   rifiutati qui. Restituisce 0 se la cella è accettata.
+*/
+static int nkk_add_row(JdmInput *in, GHashTable *pending, const char *src, int lineno,
+                       int64_t k64, int64_t l64, int64_t val64) {
+    /* Le celle nulle non portano archi e non partecipano ai controlli */
+    if (val64 == 0 && k64 >= 0 && l64 >= 0) return 0;
+    if (k64 <= 0 || l64 <= 0 || val64 < 0) {
+        fprintf(stderr, "%s:%d: gradi e valori devono essere positivi: %" PRId64 ",%" PRId64 ",%" PRId64 "\n",
+                src, lineno, k64, l64, val64);
+        return 1;
+    }
+    if (k64 > JDM_DEGREE_MAX || l64 > JDM_DEGREE_MAX || val64 > JDM_EDGE_MAX) {
+        fprintf(stderr, "%s:%d: cella %" PRId64 ",%" PRId64 ",%" PRId64 " fuori dai limiti (gradi <= %d, "
+                        "valori <= %" PRI_EDGE "%s)\n", src, lineno, k64, l64, val64, JDM_DEGREE_MAX,
+                (jdm_edge_t) JDM_EDGE_MAX, val64 > JDM_EDGE_MAX ? ": ricompilare con INDEX64=1" : "");
+        return 1;
+    }
+    int k = (int) k64, l = (int) l64;
+    jdm_edge_t val = (jdm_edge_t) val64;
+    GHashTable *inner = g_hash_table_lookup(in->nkk, JDM_TO_POINTER(k));
+    if (!inner) {
+        inner = g_hash_table_new(g_direct_hash, g_direct_equal);
+        g_hash_table_insert(in->nkk, JDM_TO_POINTER(k), inner);
+    }
+    if (g_hash_table_contains(inner, JDM_TO_POINTER(l))) {
+        fprintf(stderr, "%s:%d: cella (%d,%d) duplicata\n", src, lineno, k, l);
+        return 1;
+    }
+    g_hash_table_insert(inner, JDM_TO_POINTER(l), JDM_TO_POINTER(val));
+    /* Somma di riga per grado, accumulata in nk e convertita da jdm_input_finish */
+    int64_t s = JDM_FROM_POINTER(g_hash_table_lookup(in->nk, JDM_TO_POINTER(k)));
+    if (jdm_add_checked(&s, val, JDM_EDGE_MAX)) {
+        fprintf(stderr, "%s:%d: somma della riga di grado %d oltre %" PRI_EDGE "\n", src, lineno, k,
+                (jdm_edge_t) JDM_EDGE_MAX);
+        return 1;
+    }
+    g_hash_table_insert(in->nk, JDM_TO_POINTER(k), JDM_TO_POINTER(s));
+
+    jdm_edge_t edges;
+    if (k == l) {
+        /* Condizione 5: la diagonale conta due volte ogni arco */
+        if (val % 2 != 0) {
+            fprintf(stderr, "%s:%d: violazione della condizione 5: nkk[%d][%d] = %" PRI_EDGE " è dispari\n",
+                    src, lineno, k, l, val);
+            return 1;
+        }
+        edges = val / 2;
+    } else {
+        /* Condizione 1: simmetria. La prima delle due righe resta in sospeso. */
+        GHashTable *mirror = g_hash_table_lookup(in->nkk, JDM_TO_POINTER(l));
+        gpointer mval;
+        if (!mirror || !g_hash_table_lookup_extended(mirror, JDM_TO_POINTER(k), NULL, &mval)) {
+            g_hash_table_insert(pending, CELL_KEY(k, l), GINT_TO_POINTER(lineno));
+            return 0;
+        }
+        if ((jdm_edge_t) JDM_FROM_POINTER(mval) != val) {
+            fprintf(stderr, "%s:%d: JDM non simmetrica: nkk[%d][%d] = %" PRI_EDGE " ma nkk[%d][%d] = %" PRI_EDGE
+                            " (riga %d)\n",
+                    src, lineno, k, l, val, l, k, (jdm_edge_t) JDM_FROM_POINTER(mval),
+                    GPOINTER_TO_INT(g_hash_table_lookup(pending, CELL_KEY(k, l))));
+            return 1;
+        }
+        g_hash_table_remove(pending, CELL_KEY(k, l));
+        edges = val;
+    }
+    int64_t total_edges = in->total_edges;
+    if (jdm_add_checked(&total_edges, edges, JDM_EDGE_MAX)) {
+        fprintf(stderr, "%s:%d: più di %" PRI_EDGE " archi: ricompilare con INDEX64=1\n", src, lineno,
+                (jdm_edge_t) JDM_EDGE_MAX);
+        return 1;
+    }
+    in->total_edges = (jdm_edge_t) total_edges;
+    return 0;
+}
+
+/* load_nkk_stream:
+   Legge una JDM da fp e popola in una sola passata la JdmInput:
+   nkk (hash table: k -> (hash table: l->value)), le somme di riga e il numero di archi.
+   Il formato è riconosciuto dal primo byte: testo con righe "k,l,value", oppure
+   binario (NKK_BINARY_MAGIC). Nel testo una riga "." chiude la JDM prima della
+   fine dello stream, così più JDM possono viaggiare sulla stessa connessione
+   (modalità demone); la JDM binaria è delimitata dal numero di celle.
+   Ogni cella viene validata appena letta (formato, gradi e valori non negativi,
+   duplicati, diagonale pari, simmetria con la cella (l,k) se già letta); alla fine
+   una passata sui soli gradi verifica la divisibilità e ricava nk e total_nodes.
+   Gli errori riportano src e il numero di riga (o di cella). Restituisce 0 se la JDM è valida.
+*/
+int load_nkk_stream(FILE *fp, const char *src, JdmInput *in) {
+    in->nkk = g_hash_table_new(g_direct_hash, g_direct_equal);
+    in->nk = g_hash_table_new(g_direct_hash, g_direct_equal);
+    in->total_nodes = 0;
+    in->total_edges = 0;
+
+    GHashTable *pending = g_hash_table_new(g_direct_hash, g_direct_equal);
+    int err = 0;
+    int lineno = 0;
+    int first = getc(fp);
+    if (first != EOF) ungetc(first, fp);
+    if (first == NKK_BINARY_MAGIC[0]) {
+        unsigned char hdr[8];
+        if (fread(hdr, 1, sizeof(hdr), fp) != sizeof(hdr) || memcmp(hdr, NKK_BINARY_MAGIC, 4) != 0) {
+            fprintf(stderr, "%s: intestazione binaria non valida\n", src);
+            err = 1;
+        }
+        uint32_t n_cells = err ? 0 : read_le32(hdr + 4);
+        for (uint32_t i = 0; !err && i < n_cells; i++) {
+            unsigned char cell[12];
+            lineno++;
+            if (fread(cell, 1, sizeof(cell), fp) != sizeof(cell)) {
+                fprintf(stderr, "%s:%d: JDM binaria troncata (%u celle attese)\n", src, lineno, n_cells);
+                err = 1;
+                break;
+            }
+            err = nkk_add_row(in, pending, src, lineno, (int32_t) read_le32(cell),
+                              (int32_t) read_le32(cell + 4), (int32_t) read_le32(cell + 8));
+        }
+    } else {
+        char line[1024];
+        while (!err && fgets(line, sizeof(line), fp)) {
+            lineno++;
+            char *nl = strchr(line, '\n');
+            if (nl) *nl = '\0';
+            if (line[0] == '\0') continue;
+            if (strcmp(line, ".") == 0) break;
+            long long k, l, val;
+            char extra;
+            if (sscanf(line, "%lld,%lld,%lld %c", &k, &l, &val, &extra) != 3) {
+                fprintf(stderr, "%s:%d: riga non valida: %s\n", src, lineno, line);
+                err = 1;
+                break;
+            }
+            err = nkk_add_row(in, pending, src, lineno, k, l, val);
+        }
+    }
+
+    if (!err && g_hash_table_size(pending) > 0) {
+        GHashTableIter iter;
+        gpointer key, value;
+        g_hash_table_iter_init(&iter, pending);
+        g_hash_table_iter_next(&iter, &key, &value);
+        gsize cell = GPOINTER_TO_SIZE(key);
+        fprintf(stderr, "%s:%d: JDM non simmetrica: manca la riga simmetrica della cella (%d,%d) "
+                        "(%u celle senza simmetrica)\n",
+                src, GPOINTER_TO_INT(value), (int) (cell >> 32), (int) (cell & 0xffffffffu),
+                g_hash_table_size(pending));
+        err = 1;
+    }
+    g_hash_table_destroy(pending);
+
+    if (!err)
+        err = jdm_input_finish(in, src);
+    return err;
+}
+
+/* load_nkk:
+   Legge e valida il file .nkk fname (testo o binario) con load_nkk_stream.
+   Restituisce 0 se il file è valido.
+*/
+int load_nkk(char *fname, JdmInput *in) {
+    in->nkk = in->nk = NULL;
+    FILE *fp = fopen(fname, "r");
+    if (!fp) {
+        fprintf(stderr, "Errore: impossibile aprire il file %s\n", fname);
+        return 1;
+    }
+    printf("Caricamento file %s\n", fname);
+    int err = load_nkk_stream(fp, fname, in);
+    fclose(fp);
+    return err;
+}
+
+/* jdm_input_from_table:
+   Costruisce una JdmInput da una JDM già in memoria (per esempio calcolata da un
+   grafo nella pipeline di jdm), senza passare da un file. La JdmInput prende
+   possesso di nkk. La tabella viene da un grafo già in memoria, quindi i suoi
+   conteggi stanno nei tipi degli indici. Restituisce 0 se la JDM è valida.
+*/
+int jdm_input_from_table(GHashTable *nkk, JdmInput *in) {
+    in->nkk = nkk;
+    in->nk = g_hash_table_new(g_direct_hash, g_direct_equal);
+    in->total_nodes = 0;
+    in->total_edges = 0;
+    GHashTableIter iter;
+    gpointer key, value;
+    g_hash_table_iter_init(&iter, nkk);
+    while (g_hash_table_iter_next(&iter, &key, &value)) {
+        int k = (int) JDM_FROM_POINTER(key);
+        GHashTableIter i2;
+        gpointer k2, v2;
+        jdm_edge_t s = 0;
+        g_hash_table_iter_init(&i2, (GHashTable *) value);
+        while (g_hash_table_iter_next(&i2, &k2, &v2)) {
+            int l = (int) JDM_FROM_POINTER(k2);
+            jdm_edge_t val = (jdm_edge_t) JDM_FROM_POINTER(v2);
+            s += val;
+            if (k < l) in->total_edges += val;
+            else if (k == l) in->total_edges += val / 2;
+        }
+        if (k > 0 && s > 0)
+            g_hash_table_insert(in->nk, key, JDM_TO_POINTER(s));
+    }
+    return jdm_input_finish(in, "JDM in memoria");
+}
+
+/* Libera nkk e nk di una JdmInput (anche se il caricamento non è partito). */
+void jdm_input_destroy(JdmInput *in) {
+    if (!in->nkk) return;
+    GHashTableIter iter;
+    gpointer key, value;
+    g_hash_table_iter_init(&iter, in->nkk);
+    while (g_hash_table_iter_next(&iter, &key, &value)) {
+        GHashTable *inner = (GHashTable *) value;
+        g_hash_table_destroy(inner);
+    }
+    g_hash_table_destroy(in->nkk);
+    g_hash_table_destroy(in->nk);
+    in->nkk = in->nk = NULL;
+}
+
+/* write_graph_stream:
+   Scrive gli archi di g su fp in formato edge list "u,v" per riga.
+   Scorre i vicini ordinati di ogni nodo u e scrive solo (u,v) con u < v.
+   I nodi sono formattati a blocchi di GRAPH_TEXT_CHUNK_NODES da n_threads
+   thread e scritti nell'ordine dei nodi (jdm_write_ordered, jdm_io.h): il file
+   è lo stesso con qualunque numero di thread.
+   Restituisce il numero di archi scritti, -1 in caso di errore.
+*/
+#define GRAPH_TEXT_CHUNK_NODES 4096
+
+typedef struct {
+    const FastGraph *g;
+    long edges;   // archi formattati, sommati dai thread
+} GraphTextCtx;
+
+static int format_graph_text(void *ctx_ptr, size_t first, size_t last, JdmBuf *out) {
+    GraphTextCtx *ctx = ctx_ptr;
+    long E = 0;
+    int err = 0;
+    Arena scratch;
+    arena_init(&scratch, 0);
+    for (jdm_node_t u = (jdm_node_t) first; u < (jdm_node_t) last && !err; u++) {
+        ArenaMark mark = arena_mark(&scratch);
+        int n_neigh;
+        jdm_node_t *neighbors = fastgraph_sorted_neighbors(ctx->g, u, &n_neigh, &scratch);
+        char *p = neighbors ? jdm_buf_reserve(out, (size_t) n_neigh * (2 * JDM_LONG_CHARS + 2)) : NULL;
+        if (neighbors && !p) err = 1;
+        for (int i = 0; p && i < n_neigh; i++) {
+            if (neighbors[i] > u) {
+                p = jdm_format_long(p, (long) u);
+                *p++ = ',';
+                p = jdm_format_long(p, (long) neighbors[i]);
+                *p++ = '\n';
+                E++;
+            }
+        }
+        if (p) out->len = (size_t) (p - out->data);
+        arena_reset(&scratch, mark);
+    }
+    arena_release(&scratch);
+    __atomic_fetch_add(&ctx->edges, E, __ATOMIC_RELAXED);
+    return err;
+}
+
+long write_graph_stream(FILE *fp, const FastGraph *g, int n_threads) {
+    GraphTextCtx ctx = { g, 0 };
+    if (jdm_write_ordered(fp, (size_t) g->total_nodes, GRAPH_TEXT_CHUNK_NODES, format_graph_text, &ctx,
+                          n_threads) != 0)
+        return -1;
+    return ctx.edges;
+}
+
+/* write_graph_delta:
+   Scrive gli archi di g nel formato compresso di jdm_edges.h (delta + varint,
+   blocchi zstd se zstd != 0). Restituisce il numero di archi, -1 in caso di errore.
+*/
+static long write_graph_delta(FILE *fp, const FastGraph *g, int zstd) {
+    EdgeWriter w;
+    if (edges_writer_open(&w, fp, g->total_nodes, zstd) != 0) {
+        edges_writer_close(&w);
+        return -1;
+    }
+    Arena scratch;
+    arena_init(&scratch, 0);
+    for (jdm_node_t u = 0; u < g->total_nodes; u++) {
+        ArenaMark mark = arena_mark(&scratch);
+        int n_neigh;
+        jdm_node_t *neighbors = fastgraph_sorted_neighbors(g, u, &n_neigh, &scratch);
+        edges_writer_node(&w, u, neighbors, neighbors ? n_neigh : 0);
+        arena_reset(&scratch, mark);
+    }
+    arena_release(&scratch);
+    long E = w.total_edges;
+    return edges_writer_close(&w) == 0 ? E : -1;
+}
+
+/* Riempimento del CSR: ogni thread copia i vicini di un intervallo di nodi
+   nella propria porzione di adj (gli array ordinati così come sono, le tabelle
+   degli hub compattate e ordinate). Gli intervalli hanno circa lo stesso numero
+   di estremi, non di nodi, perché gli hub non finiscano tutti su un thread.
+*/
+#define CSR_MIN_ARCS_PER_THREAD (1 << 18)
+
+typedef struct {
+    const FastGraph *g;
+    CsrGraph *csr;
+    jdm_node_t first, last;
+    pthread_t thread;
+    int started;
+} CsrFillTask;
+
+static void *csr_fill_worker(void *arg) {
+    CsrFillTask *t = arg;
+    const FastGraph *g = t->g;
+    for (jdm_node_t u = t->first; u < t->last; u++) {
+        jdm_node_t *dst = t->csr->adj + t->csr->off[u];
+        const jdm_node_t *a = g->adj + g->adj_off[u];
+        if (fastgraph_is_hub(g, u)) {
+            int idx = 0;
+            for (long i = 0; i < fastgraph_slots(g, u); i++)
+                if (a[i] != ADJ_EMPTY) dst[idx++] = a[i];
+            qsort(dst, idx, sizeof(jdm_node_t), cmp_node);
+        } else {
+            memcpy(dst, a, g->adj_len[u] * sizeof(jdm_node_t));
+        }
+    }
+    return NULL;
+}
+
+/* Primo nodo u con off[u] >= target (off crescente, n + 1 valori). */
+static jdm_node_t csr_first_node_at(const CsrGraph *csr, uint64_t target) {
+    jdm_node_t lo = 0, hi = csr->n_nodes;
+    while (lo < hi) {
+        jdm_node_t mid = lo + (hi - lo) / 2;
+        if (csr->off[mid] < target) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+/* write_graph_csr:
+   Scrive g in fname come CSR (jdm_csr.h) direttamente nella mappatura del file:
+   gli offset con una somma prefissa, i vicini in parallelo con csr_fill_worker.
+   Restituisce il numero di archi, -1 in caso di errore.
+*/
+static long write_graph_csr(const char *fname, const FastGraph *g) {
+    jdm_node_t n = g->total_nodes;
+    uint64_t n_arcs = 0;
+    for (jdm_node_t u = 0; u < n; u++)
+        n_arcs += (uint64_t) g->adj_len[u];
+    CsrGraph csr;
+    if (csr_create(fname, n, n_arcs, &csr) != 0) return -1;
+    csr.off[0] = 0;
+    for (jdm_node_t u = 0; u < n; u++)
+        csr.off[u + 1] = csr.off[u] + (uint64_t) g->adj_len[u];
+
+    long n_threads = sysconf(_SC_NPROCESSORS_ONLN);
+    if ((uint64_t) n_threads > n_arcs / CSR_MIN_ARCS_PER_THREAD)
+        n_threads = (long) (n_arcs / CSR_MIN_ARCS_PER_THREAD);
+    if (n_threads < 1) n_threads = 1;
+    CsrFillTask *tasks = calloc(n_threads, sizeof(CsrFillTask));
+    if (!tasks) {
+        fprintf(stderr, "Errore: memoria esaurita scrivendo %s\n", fname);
+        csr_unmap(&csr);
+        return -1;
+    }
+    for (long t = 0; t < n_threads; t++) {
+        tasks[t].g = g;
+        tasks[t].csr = &csr;
+        tasks[t].first = t == 0 ? 0 : tasks[t - 1].last;
+        tasks[t].last = t == n_threads - 1 ? n
+                                           : csr_first_node_at(&csr, n_arcs * (uint64_t) (t + 1) / n_threads);
+    }
+    /* Il thread chiamante riempie il primo intervallo, e quelli dei thread che non partono */
+    for (long t = 1; t < n_threads; t++)
+        tasks[t].started = pthread_create(&tasks[t].thread, NULL, csr_fill_worker, &tasks[t]) == 0;
+    csr_fill_worker(&tasks[0]);
+    for (long t = 1; t < n_threads; t++) {
+        if (tasks[t].started) pthread_join(tasks[t].thread, NULL);
+        else csr_fill_worker(&tasks[t]);
+    }
+    free(tasks);
+    csr_unmap(&csr);
+    return (long) (n_arcs / 2);
+}
+
+static const char *const graph_format_names[] = { "text", "delta", "zstd", "csr" };
+
+int parse_graph_format(const char *name, GraphFormat *format) {
+    for (int f = GRAPH_TEXT; f <= GRAPH_CSR; f++) {
+        if (strcmp(name, graph_format_names[f]) == 0) {
+#if !JDM_ZSTD
+            if (f == GRAPH_DELTA_ZSTD) {
+                fprintf(stderr, "Formato zstd non disponibile: ricompilare con ZSTD=1\n");
+                return 1;
+            }
+#endif
+            *format = (GraphFormat) f;
+            return 0;
+        }
+    }
+    fprintf(stderr, "Formato sconosciuto: %s (text, delta, zstd, csr)\n", name);
+    return 1;
+}
+
+/* write_graph: scrive gli archi di g nel file fname nel formato scelto
+   (testo con write_graph_stream, compresso con write_graph_delta, oppure CSR
+   con write_graph_csr, che scrive nella mappatura del file e non passa da un FILE).
+   Restituisce 0 se il file è stato scritto e chiuso senza errori. */
+int write_graph(char *fname, const FastGraph *g, GraphFormat format) {
+    long E;
+    if (format == GRAPH_CSR) {
+        printf("Scrittura del file %s (%s).\n", fname, graph_format_names[format]);
+        E = write_graph_csr(fname, g);
+    } else {
+        FILE *fp = fopen(fname, "w");
+        if (!fp) {
+            fprintf(stderr, "Errore: impossibile aprire il file %s per scrittura.\n", fname);
+            return 1;
+        }
+        printf("Scrittura del file %s (%s).\n", fname, graph_format_names[format]);
+        long n_threads = sysconf(_SC_NPROCESSORS_ONLN);
+        E = format == GRAPH_TEXT ? write_graph_stream(fp, g, n_threads > 0 ? (int) n_threads : 1)
+                                 : write_graph_delta(fp, g, format == GRAPH_DELTA_ZSTD);
+        if (fclose(fp) != 0) E = -1;
+    }
+    if (E < 0) {
+        fprintf(stderr, "Errore: scrittura del file %s non riuscita.\n", fname);
+        return 1;
+    }
+    printf("%ld archi. Fatto.\n", E);
+    return 0;
+}
+
+/* ===============================
+   6) Conversione in igraph (Ibrida)
+   =============================== */
+/* Converte il FastGraph (costruito velocemente) in un grafo igraph.
+   Qui utilizziamo l'edge list accumulata nell'igraph_vector_int_t.
+*/
+void convert_to_igraph(const FastGraph *g, igraph_t *igraph_graph, const igraph_vector_int_t *edge_list) {
+    jdm_node_t n = g->total_nodes;
+    /* Usa igraph_create per creare il grafo in un'unica chiamata */
+    if (igraph_create(igraph_graph, edge_list, n, IGRAPH_UNDIRECTED) != IGRAPH_SUCCESS) {
+        fprintf(stderr, "Errore: igraph_create fallita.\n");
+        return;
+    }
+}
+
+/* Converte il FastGraph in igraph leggendo gli archi dalle liste di adiacenza.
+   A differenza dell'edge list accumulata, che non registra gli spostamenti fatti
+   da neighbor_switch, riflette sempre il grafo finale: è quella da usare per
+   ricalcolarne la JDM (pipeline di jdm).
+*/
+void fastgraph_to_igraph(const FastGraph *g, igraph_t *igraph_graph) {
+    jdm_node_t n = g->total_nodes;
+    igraph_vector_int_t edges;
+    igraph_vector_int_init(&edges, 0);
+    for (jdm_node_t u = 0; u < n; u++) {
+        const jdm_node_t *a = g->adj + g->adj_off[u];
+        for (long i = 0; i < fastgraph_slots(g, u); i++) {
+            if (a[i] > u && (fastgraph_is_hub(g, u) || i < g->adj_len[u])) {
+                igraph_vector_int_push_back(&edges, u);
+                igraph_vector_int_push_back(&edges, a[i]);
+            }
+        }
+    }
+    if (igraph_create(igraph_graph, &edges, n, IGRAPH_UNDIRECTED) != IGRAPH_SUCCESS)
+        fprintf(stderr, "Errore: igraph_create fallita.\n");
+    igraph_vector_int_destroy(&edges);
+}
+
+/* ===============================
+   7) Riparazione incrementale
+   =============================== */
+
+/* Cella della differenza tra JDM obiettivo e JDM corrente, contata in archi:
+   diff > 0 mancano archi fra gradi k e l, diff < 0 ce ne sono in eccesso.
+   edges contiene gli id degli archi del grafo appartenenti alla classe (k,l).
+   delta_pos è la posizione in delta (-1 se diff == 0), open_pos[0] e open_pos[1]
+   le posizioni negli elenchi open_by_degree di k e di l.
+*/
+typedef struct {
+    int k, l;
+    jdm_edge_t diff;
+    int delta_pos;
+    guint open_pos[2];
+    GArray *edges;
+} RepairCell;
+
+/* Stato della riparazione: archi del grafo (eu[e], ev[e]) con la posizione
+   epos[e] nella lista della propria classe, per la rimozione swap-remove in O(1).
+   delta e open_by_degree contengono solo le celle con diff != 0, e una cella ne
+   esce (swap-remove) appena torna in pari: la ricerca delle mosse scorre le celle
+   ancora da sistemare, non la JDM né gli archi. by_degree, con tutte le celle,
+   serve solo all'estrazione casuale delle mosse neutre.
+*/
+typedef struct {
+    GHashTable *cells;      /* CELL_KEY(k,l) -> RepairCell* */
+    GArray *delta;          /* RepairCell* con diff != 0 */
+    GHashTable *open_by_degree; /* grado -> GArray delle RepairCell* con diff != 0 che lo contengono */
+    GHashTable *by_degree;  /* grado -> GArray di tutte le RepairCell* che lo contengono */
+    jdm_node_t *eu, *ev;
+    jdm_edge_t *epos;
+    int *degree;
+    jdm_edge_t total_diff;  /* somma di |diff| su tutte le celle */
+} RepairState;
+
+/* Accoda c all'elenco del grado k in index; restituisce la posizione. */
+static guint repair_index_degree(GHashTable *index, int k, RepairCell *c) {
+    GArray *arr = g_hash_table_lookup(index, JDM_TO_POINTER(k));
+    if (!arr) {
+        arr = g_array_new(FALSE, FALSE, sizeof(RepairCell *));
+        g_hash_table_insert(index, JDM_TO_POINTER(k), arr);
+    }
+    g_array_append_val(arr, c);
+    return arr->len - 1;
+}
+
+static RepairCell *repair_cell(RepairState *st, int k, int l) {
+    RepairCell *c = g_hash_table_lookup(st->cells, CELL_KEY(k, l));
+    if (!c) {
+        c = g_new(RepairCell, 1);
+        c->k = k < l ? k : l;
+        c->l = k < l ? l : k;
+        c->diff = 0;
+        c->delta_pos = -1;
+        c->edges = g_array_new(FALSE, FALSE, sizeof(jdm_edge_t));
+        g_hash_table_insert(st->cells, CELL_KEY(k, l), c);
+        repair_index_degree(st->by_degree, c->k, c);
+        if (c->l != c->k) repair_index_degree(st->by_degree, c->l, c);
+    }
+    return c;
+}
+
+static void repair_cell_free(gpointer p) {
+    RepairCell *c = p;
+    g_array_free(c->edges, TRUE);
+    g_free(c);
+}
+
+static void repair_array_free(gpointer p) {
+    g_array_free((GArray *) p, TRUE);
+}
+
+/* Toglie c dall'elenco open_by_degree del grado k (swap-remove). */
+static void repair_unindex_degree(RepairState *st, int k, RepairCell *c) {
+    GArray *arr = g_hash_table_lookup(st->open_by_degree, JDM_TO_POINTER(k));
+    guint pos = c->open_pos[c->k == k ? 0 : 1];
+    RepairCell *last = g_array_index(arr, RepairCell *, arr->len - 1);
+    g_array_index(arr, RepairCell *, pos) = last;
+    last->open_pos[last->k == k ? 0 : 1] = pos;
+    g_array_set_size(arr, arr->len - 1);
+}
+
+/* Aggiorna diff della cella e total_diff; la cella entra in delta e in
+   open_by_degree quando diventa diversa da zero e ne esce quando torna a zero. */
+static void repair_set_diff(RepairState *st, RepairCell *c, jdm_edge_t diff) {
+    st->total_diff += (jdm_edge_t) (llabs(diff) - llabs(c->diff));
+    c->diff = diff;
+    if (diff != 0 && c->delta_pos < 0) {
+        c->delta_pos = (int) st->delta->len;
+        g_array_append_val(st->delta, c);
+        c->open_pos[0] = repair_index_degree(st->open_by_degree, c->k, c);
+        if (c->l != c->k) c->open_pos[1] = repair_index_degree(st->open_by_degree, c->l, c);
+    } else if (diff == 0 && c->delta_pos >= 0) {
+        RepairCell *last = g_array_index(st->delta, RepairCell *, st->delta->len - 1);
+        g_array_index(st->delta, RepairCell *, c->delta_pos) = last;
+        last->delta_pos = c->delta_pos;
+        g_array_set_size(st->delta, st->delta->len - 1);
+        c->delta_pos = -1;
+        repair_unindex_degree(st, c->k, c);
+        if (c->l != c->k) repair_unindex_degree(st, c->l, c);
+    }
+}
+
+static void repair_class_remove(RepairState *st, RepairCell *c, jdm_edge_t e) {
+    jdm_edge_t pos = st->epos[e];
+    jdm_edge_t last = g_array_index(c->edges, jdm_edge_t, c->edges->len - 1);
+    g_array_index(c->edges, jdm_edge_t, pos) = last;
+    st->epos[last] = pos;
+    g_array_set_size(c->edges, c->edges->len - 1);
+}
+
+static void repair_class_add(RepairState *st, RepairCell *c, jdm_edge_t e) {
+    st->epos[e] = c->edges->len;
+    g_array_append_val(c->edges, e);
+}
+
+/* Cerca due archi reali per lo scambio
+      (a,b) in classe (x,y), (c,d) in classe (z,w)  ->  (a,d) e (c,b)
+   con deg(a)=x, deg(b)=y, deg(c)=z, deg(d)=w, quattro nodi distinti e
+   (a,d), (c,b) non ancora presenti. Prova al più max_tries coppie casuali.
+*/
+static int repair_pick(RepairState *st, const FastGraph *g, int x, int y, int z, int w,
+                       int max_tries, jdm_edge_t *e1_out, jdm_edge_t *e2_out) {
+    RepairCell *cxy = g_hash_table_lookup(st->cells, CELL_KEY(x, y));
+    RepairCell *czw = g_hash_table_lookup(st->cells, CELL_KEY(z, w));
+    if (!cxy || !czw || cxy->edges->len == 0 || czw->edges->len == 0) return 0;
+    for (int t = 0; t < max_tries; t++) {
+        jdm_edge_t e1 = g_array_index(cxy->edges, jdm_edge_t, rand_below(cxy->edges->len));
+        jdm_edge_t e2 = g_array_index(czw->edges, jdm_edge_t, rand_below(czw->edges->len));
+        if (e1 == e2) continue;
+        jdm_node_t a = st->eu[e1], b = st->ev[e1];
+        if (st->degree[a] != x || (x == y && rand() % 2)) { jdm_node_t tmp = a; a = b; b = tmp; }
+        jdm_node_t c = st->eu[e2], d = st->ev[e2];
+        if (st->degree[c] != z || (z == w && rand() % 2)) { jdm_node_t tmp = c; c = d; d = tmp; }
+        if (a == c || a == d || b == c || b == d) continue;
+        if (fastgraph_has_edge(g, a, d) || fastgraph_has_edge(g, c, b)) continue;
+        /* Orientamento finale: e1 = (a,b), e2 = (c,d) */
+        st->eu[e1] = a; st->ev[e1] = b;
+        st->eu[e2] = c; st->ev[e2] = d;
+        *e1_out = e1;
+        *e2_out = e2;
+        return 1;
+    }
+    return 0;
+}
+
+/* Variazione di total_diff (cambiata di segno) prodotta dallo scambio
+      (x,y)-1, (z,w)-1, (x,w)+1, (z,y)+1
+   calcolata esattamente anche quando alcune delle quattro celle coincidono. */
+static int repair_gain(RepairState *st, int x, int y, int z, int w) {
+    gpointer keys[4] = { CELL_KEY(x, y), CELL_KEY(z, w), CELL_KEY(x, w), CELL_KEY(z, y) };
+    int change[4] = { +1, +1, -1, -1 };
+    int gain = 0;
+    for (int i = 0; i < 4; i++) {
+        int first = 1, total = 0;
+        for (int j = 0; j < 4; j++) {
+            if (keys[j] != keys[i]) continue;
+            if (j < i) first = 0;
+            total += change[j];
+        }
+        if (!first) continue;
+        RepairCell *c = g_hash_table_lookup(st->cells, keys[i]);
+        jdm_edge_t diff = c ? c->diff : 0;
+        gain += (int) (llabs(diff) - llabs(diff + total));
+    }
+    return gain;
+}
+
+/* Esamina le mosse con (x,y) in eccesso e (x,w) in difetto, prendendo come z
+   gli altri estremi delle celle ancora da sistemare che contengono w o y.
+   Aggiorna la mossa migliore trovata (guadagno > *best_gain e archi reali disponibili). */
+static void repair_scan(RepairState *st, const FastGraph *g, int x, int y, int w,
+                        int *best_gain, int *best, jdm_edge_t *be1, jdm_edge_t *be2) {
+    int ends[2] = { w, y };
+    for (int side = 0; side < 2 && *best_gain < 4; side++) {
+        GArray *arr = g_hash_table_lookup(st->open_by_degree, JDM_TO_POINTER(ends[side]));
+        if (!arr) continue;
+        for (guint h = 0; h < arr->len && *best_gain < 4; h++) {
+            RepairCell *c2 = g_array_index(arr, RepairCell *, h);
+            int z = c2->k == ends[side] ? c2->l : c2->k;
+            int gain = repair_gain(st, x, y, z, w);
+            if (gain <= *best_gain) continue;
+            jdm_edge_t e1, e2;
+            if (repair_pick(st, g, x, y, z, w, 64, &e1, &e2)) {
+                *best_gain = gain;
+                best[0] = x; best[1] = y; best[2] = z; best[3] = w;
+                *be1 = e1;
+                *be2 = e2;
+            }
+        }
+    }
+}
+
+/* repair_graph:
+   Porta il grafo g (archi in edges, coppie di jdm_node_t) dalla propria JDM alla JDM in->nkk
+   con scambi locali di archi che preservano i gradi, come quelli di jdm_mutate:
+      (x,y)-1, (z,w)-1, (x,w)+1, (z,y)+1.
+   Ad ogni passo parte da una cella in eccesso scelta a caso e cerca, fra le sole
+   celle delta adiacenti, lo scambio che riduce di più la differenza (4 o 2 unità);
+   se nessuno è realizzabile esegue una mossa neutra per sbloccare la situazione.
+   La lettura del grafo è O(m), la riparazione è proporzionale alla differenza.
+   Restituisce 0 se il grafo finale ha esattamente la JDM nkk.
+*/
+int repair_graph(const JdmInput *in, FastGraph *g, GArray *edges) {
+    printf("repair_graph\n");
+    if (!is_valid_joint_degree(in)) {
+        printf("La distribuzione nkk non è realizzabile come grafo semplice.\n");
+        return 1;
+    }
+    jdm_node_t n = g->total_nodes;
+    jdm_edge_t m = edges->len / 2;
+    RepairState st;
+    st.cells = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, repair_cell_free);
+    st.by_degree = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, repair_array_free);
+    st.open_by_degree = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, repair_array_free);
+    st.delta = g_array_new(FALSE, FALSE, sizeof(RepairCell *));
+    st.total_diff = 0;
+    st.eu = malloc(((size_t) m + 1) * sizeof(jdm_node_t));
+    st.ev = malloc(((size_t) m + 1) * sizeof(jdm_node_t));
+    st.epos = malloc(((size_t) m + 1) * sizeof(jdm_edge_t));
+    st.degree = calloc((size_t) n + 1, sizeof(int));
+    if (!st.eu || !st.ev || !st.epos || !st.degree) {
+        fprintf(stderr, "Errore: impossibile allocare lo stato di riparazione\n");
+        return 1;
+    }
+
+    for (jdm_edge_t e = 0; e < m; e++) {
+        st.eu[e] = g_array_index(edges, jdm_node_t, 2 * e);
+        st.ev[e] = g_array_index(edges, jdm_node_t, 2 * e + 1);
+        st.degree[st.eu[e]]++;
+        st.degree[st.ev[e]]++;
+    }
+    /* Classi di archi e JDM corrente (diff = -corrente) */
+    for (jdm_edge_t e = 0; e < m; e++) {
+        RepairCell *c = repair_cell(&st, st.degree[st.eu[e]], st.degree[st.ev[e]]);
+        repair_class_add(&st, c, e);
+        c->diff--;
+    }
+    /* La sequenza dei gradi deve coincidere con quella della JDM obiettivo. */
+    GHashTable *nk_graph = g_hash_table_new(g_direct_hash, g_direct_equal);
+    for (jdm_node_t v = 0; v < n; v++) {
+        if (st.degree[v] == 0) continue;
+        jdm_node_t old = (jdm_node_t) JDM_FROM_POINTER(g_hash_table_lookup(nk_graph, JDM_TO_POINTER(st.degree[v])));
+        g_hash_table_insert(nk_graph, JDM_TO_POINTER(st.degree[v]), JDM_TO_POINTER(old + 1));
+    }
+    int degrees_ok = 1;
+    {
+        GHashTableIter iter;
+        gpointer key, value;
+        int n_classes = 0;
+        g_hash_table_iter_init(&iter, in->nkk);
+        while (g_hash_table_iter_next(&iter, &key, &value)) {
+            int k = (int) JDM_FROM_POINTER(key);
+            GHashTable *inner = (GHashTable *) value;
+            GHashTableIter i2;
+            gpointer k2, v2;
+            g_hash_table_iter_init(&i2, inner);
+            while (g_hash_table_iter_next(&i2, &k2, &v2)) {
+                int l = (int) JDM_FROM_POINTER(k2);
+                jdm_edge_t val = (jdm_edge_t) JDM_FROM_POINTER(v2);
+                /* Obiettivo in archi: la diagonale conta due volte ogni arco */
+                if (k < l)
+                    repair_cell(&st, k, l)->diff += val;
+                else if (k == l)
+                    repair_cell(&st, k, l)->diff += val / 2;
+            }
+        }
+        g_hash_table_iter_init(&iter, in->nk);
+        while (g_hash_table_iter_next(&iter, &key, &value)) {
+            int k = (int) JDM_FROM_POINTER(key);
+            jdm_node_t want = (jdm_node_t) JDM_FROM_POINTER(value);
+            if (want == 0) continue;
+            n_classes++;
+            jdm_node_t have = (jdm_node_t) JDM_FROM_POINTER(g_hash_table_lookup(nk_graph, JDM_TO_POINTER(k)));
+            if (have != want) {
+                fprintf(stderr, "Errore: il grafo ha %" PRI_NODE " nodi di grado %d, la JDM ne richiede %" PRI_NODE "\n",
+                        have, k, want);
+                degrees_ok = 0;
+            }
+        }
+        if ((int) g_hash_table_size(nk_graph) != n_classes) {
+            fprintf(stderr, "Errore: il grafo contiene gradi assenti dalla JDM obiettivo\n");
+            degrees_ok = 0;
+        }
+    }
+    g_hash_table_destroy(nk_graph);
+
+    /* Indicizza le celle con differenza non nulla */
+    {
+        GHashTableIter iter;
+        gpointer key, value;
+        g_hash_table_iter_init(&iter, st.cells);
+        while (g_hash_table_iter_next(&iter, &key, &value)) {
+            RepairCell *c = value;
+            jdm_edge_t diff = c->diff;
+            c->diff = 0;
+            repair_set_diff(&st, c, diff);
+        }
+    }
+    printf("#Celle diverse:%u\n#Archi da spostare:%" PRI_EDGE "\n", st.delta->len, st.total_diff / 2);
+
+    long n_swaps = 0, n_neutral = 0;
+    int result = degrees_ok ? 0 : 1;
+    long max_neutral = 4 * (long) st.total_diff + 64;
+    while (degrees_ok && st.total_diff > 0) {
+        int best_gain = -1, best[4] = { 0, 0, 0, 0 };
+        jdm_edge_t be1 = -1, be2 = -1;
+        guint start = rand() % st.delta->len;
+        for (guint i = 0; i < st.delta->len && best_gain < 2; i++) {
+            RepairCell *s1 = g_array_index(st.delta, RepairCell *, (start + i) % st.delta->len);
+            if (s1->diff >= 0) continue;
+            for (int o1 = 0; o1 < 2 && best_gain < 4; o1++) {
+                int x = o1 ? s1->l : s1->k, y = o1 ? s1->k : s1->l;
+                if (o1 && s1->k == s1->l) break;
+                GArray *at_x = g_hash_table_lookup(st.open_by_degree, JDM_TO_POINTER(x));
+                for (guint j = 0; at_x && j < at_x->len && best_gain < 4; j++) {
+                    RepairCell *d1 = g_array_index(at_x, RepairCell *, j);
+                    if (d1->diff <= 0) continue;
+                    int w = d1->k == x ? d1->l : d1->k;
+                    repair_scan(&st, g, x, y, w, &best_gain, best, &be1, &be2);
+                }
+            }
+        }
+        if (best_gain < 2) {
+            /* Nessuno scambio migliorativo realizzabile: gli archi degli hub bloccano
+               le mosse. Si esegue uno scambio che non cambia la JDM, fra un arco
+               (a,b) di una cella delta e un arco (c,d) con deg(c) = deg(a):
+               (a,b),(c,d) -> (a,d),(c,b) ridistribuisce i vicini fra nodi dello
+               stesso grado e sblocca le mosse successive. */
+            if (++n_neutral > max_neutral) {
+                result = 1;
+                break;
+            }
+            for (int t = 0; t < 32; t++) {
+                RepairCell *c1 = g_array_index(st.delta, RepairCell *, rand() % st.delta->len);
+                if (c1->edges->len == 0) continue;
+                int x = rand() % 2 ? c1->k : c1->l, y = x == c1->k ? c1->l : c1->k;
+                GArray *at_x = g_hash_table_lookup(st.by_degree, JDM_TO_POINTER(x));
+                RepairCell *c2 = g_array_index(at_x, RepairCell *, rand() % at_x->len);
+                int w = c2->k == x ? c2->l : c2->k;
+                if (repair_pick(&st, g, x, y, x, w, 4, &be1, &be2)) {
+                    best_gain = 0;
+                    best[0] = x; best[1] = y; best[2] = x; best[3] = w;
+                    break;
+                }
+            }
+            if (best_gain < 0) continue;
+        }
+        /* Esegue lo scambio (a,b),(c,d) -> (a,d),(c,b) */
+        int x = best[0], y = best[1], z = best[2], w = best[3];
+        jdm_node_t a = st.eu[be1], b = st.ev[be1], c = st.eu[be2], d = st.ev[be2];
+        fastgraph_remove_edge(g, a, b);
+        fastgraph_remove_edge(g, c, d);
+        if (fastgraph_add_edge(g, a, d) != 0 || fastgraph_add_edge(g, c, b) != 0) {
+            /* repair_pick ha già escluso archi presenti e loop */
+            fprintf(stderr, "Errore: scambio (%" PRI_NODE ",%" PRI_NODE "),(%" PRI_NODE ",%" PRI_NODE ") non applicabile\n",
+                    a, b, c, d);
+            result = 1;
+            break;
+        }
+        RepairCell *cxy = repair_cell(&st, x, y), *czw = repair_cell(&st, z, w);
+        RepairCell *cxw = repair_cell(&st, x, w), *czy = repair_cell(&st, z, y);
+        repair_class_remove(&st, cxy, be1);
+        repair_class_remove(&st, czw, be2);
+        st.ev[be1] = d;
+        st.ev[be2] = b;
+        repair_class_add(&st, cxw, be1);
+        repair_class_add(&st, czy, be2);
+        repair_set_diff(&st, cxy, cxy->diff + 1);
+        repair_set_diff(&st, czw, czw->diff + 1);
+        repair_set_diff(&st, cxw, cxw->diff - 1);
+        repair_set_diff(&st, czy, czy->diff - 1);
+        n_swaps++;
+    }
+
+    if (result != 0 && degrees_ok)
+        fprintf(stderr, "Errore: riparazione incompleta, restano %" PRI_EDGE " unità di differenza "
+                        "dopo %ld scambi\n", st.total_diff, n_swaps);
+    printf("#Swaps:%ld\n#Mosse neutre:%ld\n", n_swaps, n_neutral);
+
+    /* Aggiorna edges con gli estremi finali */
+    for (jdm_edge_t e = 0; e < m; e++) {
+        g_array_index(edges, jdm_node_t, 2 * e) = st.eu[e];
+        g_array_index(edges, jdm_node_t, 2 * e + 1) = st.ev[e];
+    }
+    free(st.eu);
+    free(st.ev);
+    free(st.epos);
+    free(st.degree);
+    g_array_free(st.delta, TRUE);
+    g_hash_table_destroy(st.by_degree);
+    g_hash_table_destroy(st.open_by_degree);
+    g_hash_table_destroy(st.cells);
+    return result;
+}
+
+/* load_graph:
+   Legge un file di edge list, testuale "u,v", compresso (jdm_edges.h) o CSR
+   (jdm_csr.h, mappato), e accoda le coppie (jdm_node_t) in edges. Id oltre JDM_NODE_MAX e archi oltre
+   JDM_EDGE_MAX vengono rifiutati, così come i loop; gli archi ripetuti li rifiuta
+   qui il formato CSR (vicini crescenti) e per gli altri formati repair_main,
+   quando inserisce gli archi nel FastGraph.
+   Restituisce il numero di nodi (id massimo + 1), -1 in caso di errore.
+*/
+jdm_node_t load_graph(char *fname, GArray *edges) {
+    FILE *fp = fopen(fname, "r");
+    if (!fp) {
+        fprintf(stderr, "Errore: impossibile aprire il file %s\n", fname);
+        return -1;
+    }
+    printf("Caricamento grafo %s\n", fname);
+    if (csr_file_is_csr(fname)) {
+        fclose(fp);
+        CsrGraph csr;
+        if (csr_map(fname, &csr) != 0) return -1;
+        if (csr.n_arcs / 2 > (uint64_t) JDM_EDGE_MAX || csr.n_arcs > G_MAXUINT - edges->len) {
+            fprintf(stderr, "Errore: %s ha troppi archi (%" PRIu64 ")\n", fname, csr.n_arcs / 2);
+            csr_unmap(&csr);
+            return -1;
+        }
+        g_array_set_size(edges, edges->len + (guint) csr.n_arcs);
+        jdm_node_t *out = &g_array_index(edges, jdm_node_t, edges->len - csr.n_arcs);
+        for (jdm_node_t u = 0; u < csr.n_nodes; u++) {
+            for (uint64_t i = csr.off[u]; i < csr.off[u + 1]; i++) {
+                jdm_node_t v = csr.adj[i];
+                /* vicini strettamente crescenti: niente duplicati */
+                if (v < 0 || v >= csr.n_nodes || v == u || (i > csr.off[u] && v <= csr.adj[i - 1])) {
+                    fprintf(stderr, "Errore: %s: vicino %" PRI_NODE " non valido per il nodo %" PRI_NODE "\n",
+                            fname, v, u);
+                    csr_unmap(&csr);
+                    return -1;
+                }
+                if (v > u) {
+                    *out++ = u;
+                    *out++ = v;
+                }
+            }
+        }
+        /* metà degli estremi: il CSR ha ogni arco nelle due direzioni */
+        g_array_set_size(edges, (guint) (out - (jdm_node_t *) edges->data));
+        jdm_node_t n = csr.n_nodes;
+        csr_unmap(&csr);
+        printf("  %u archi. Fatto.\n", edges->len / 2);
+        return n;
+    }
+    if (edges_is_compressed(fp)) {
+        jdm_node_t *pairs;
+        long n_pairs, n_nodes;
+        long n_threads = sysconf(_SC_NPROCESSORS_ONLN);
+        int err = edges_read(fp, fname, n_threads > 0 ? (int) n_threads : 1, &pairs, &n_pairs, &n_nodes);
+        fclose(fp);
+        if (err) return -1;
+        if (n_pairs > JDM_EDGE_MAX || 2 * (uint64_t) n_pairs > G_MAXUINT) {
+            fprintf(stderr, "Errore: %s ha troppi archi (%ld)\n", fname, n_pairs);
+            free(pairs);
+            return -1;
+        }
+        g_array_append_vals(edges, pairs, 2 * n_pairs);
+        free(pairs);
+        printf("  %u archi. Fatto.\n", edges->len / 2);
+        return (jdm_node_t) n_nodes;
+    }
+    jdm_node_t max_id = -1;
+    char line[256];
+    int lineno = 0;
+    jdm_edge_t n_edges = 0;
+    while (fgets(line, sizeof(line), fp)) {
+        long long u64, v64;
+        lineno++;
+        char *nl = strchr(line, '\n');
+        if (nl) *nl = '\0';
+        if (line[strspn(line, " \t\r")] == '\0') continue;
+        char extra;
+        if (sscanf(line, "%lld,%lld %c", &u64, &v64, &extra) != 2) {
+            fprintf(stderr, "%s:%d: riga non valida: %s\n", fname, lineno, line);
+            fclose(fp);
+            return -1;
+        }
+        if (u64 < 0 || v64 < 0 || u64 >= JDM_NODE_MAX || v64 >= JDM_NODE_MAX) {
+            fprintf(stderr, "%s:%d: id di nodo fuori dai limiti (0..%" PRI_NODE ")\n", fname, lineno,
+                    (jdm_node_t) (JDM_NODE_MAX - 1));
+            fclose(fp);
+            return -1;
+        }
+        if (n_edges == JDM_EDGE_MAX || edges->len + 2 > G_MAXUINT) {
+            fprintf(stderr, "%s:%d: troppi archi\n", fname, lineno);
+            fclose(fp);
+            return -1;
+        }
+        jdm_node_t u = (jdm_node_t) u64, v = (jdm_node_t) v64;
+        if (u == v) {
+            fprintf(stderr, "Errore: loop (%" PRI_NODE ",%" PRI_NODE ") nel grafo di partenza\n", u, v);
+            fclose(fp);
+            return -1;
+        }
+        g_array_append_val(edges, u);
+        g_array_append_val(edges, v);
+        n_edges++;
+        if (u > max_id) max_id = u;
+        if (v > max_id) max_id = v;
+    }
+    fclose(fp);
+    printf("  %u archi. Fatto.\n", edges->len / 2);
+    return max_id + 1;
+}
+
+/* repair_main:
+   Modalità -r: carica il grafo esistente, lo ripara verso la JDM letta
+   e lo scrive in generated.graph.
+*/
+int repair_main(char *graph_fname, JdmInput *in, GraphFormat format) {
+    GArray *edges = g_array_new(FALSE, FALSE, sizeof(jdm_node_t));
+    jdm_node_t n = load_graph(graph_fname, edges);
+    if (n < 0) {
+        g_array_free(edges, TRUE);
+        jdm_input_destroy(in);
+        return 1;
+    }
+
+    printf("Esecuzione della riparazione\n");
+    struct timeval tp1, tp2;
+    gettimeofday(&tp1, NULL);
+
+    /* I gradi del grafo letto dimensionano l'adiacenza: gli scambi li preservano. */
+    int *degree = calloc((size_t) n + 1, sizeof(int));
+    if (!degree) {
+        g_array_free(edges, TRUE);
+        jdm_input_destroy(in);
+        return 1;
+    }
+    for (guint i = 0; i < edges->len; i++)
+        degree[g_array_index(edges, jdm_node_t, i)]++;
+    FastGraph fast_g = { 0 };
+    int init_err = fastgraph_init(&fast_g, n, degree);
+    free(degree);
+    if (init_err != 0) {
+        g_array_free(edges, TRUE);
+        jdm_input_destroy(in);
+        return 1;
+    }
+    /* Un arco ripetuto falserebbe i gradi su cui lavora la riparazione: il grafo
+       di partenza deve essere semplice (i loop li rifiuta già load_graph). */
+    for (guint e = 0; e < edges->len / 2; e++) {
+        jdm_node_t u = g_array_index(edges, jdm_node_t, 2 * e), v = g_array_index(edges, jdm_node_t, 2 * e + 1);
+        if (fastgraph_add_edge(&fast_g, u, v) != 0) {
+            fprintf(stderr, "Errore: arco (%" PRI_NODE ",%" PRI_NODE ") ripetuto nel grafo di partenza\n", u, v);
+            fastgraph_destroy(&fast_g);
+            g_array_free(edges, TRUE);
+            jdm_input_destroy(in);
+            return 1;
+        }
+    }
+    int result = repair_graph(in, &fast_g, edges);
+
+    gettimeofday(&tp2, NULL);
+    double runtime = ((tp2.tv_sec - tp1.tv_sec) * 1000000 + (tp2.tv_usec - tp1.tv_usec)) / 1e6;
+    printf("Tempo:%.3f secondi\n", runtime);
+
+    if (result == 0) {
+        result = write_graph("generated.graph", &fast_g, format);
+        if (result == 0)
+            printf("Grafo 'generated.graph' generato in formato edge list\n");
+    }
+
+    fastgraph_destroy(&fast_g);
+    g_array_free(edges, TRUE);
+    jdm_input_destroy(in);
+    return result;
+}
+
+/* ===============================
+   8) Modalità demone
+   =============================== */
+
+/* Con -d ibrido resta in ascolto su un socket Unix (o su stdin/stdout con "-d -")
+   e costruisce un grafo per ogni JDM ricevuta. Su ogni connessione, per ogni richiesta:
+   - il client invia una JDM testuale chiusa da una riga "." (o dalla fine dello
+     stream) oppure una JDM binaria (vedi load_nkk_stream);
+   - il demone risponde con gli archi "u,v", uno per riga, seguiti da una riga
+     "# ok nodi=N archi=E ms=T", oppure (JDM non valida o costruzione non
+     riuscita) solo "# errore ...", senza archi, e chiude la connessione.
+   Le connessioni accettate entrano in una coda limitata (-q) servita da -j
+   worker: a coda piena l'accept attende che un worker si liberi. Ogni worker
+   riusa tra una richiesta e l'altra il pool di adiacenza (fastgraph_init) e
+   l'edge list. La latenza di ogni richiesta (attesa in coda, lettura,
+   costruzione, invio) viene riportata su stderr.
+   Un client che resta fermo più di DAEMON_IO_TIMEOUT secondi (in lettura o in
+   scrittura) perde la connessione, così non tiene occupato un worker per sempre.
+   Con la coda piena l'accept ricontrolla l'arresto ogni DAEMON_STOP_POLL_MS.
+*/
+#define DAEMON_QUEUE_DEFAULT 64
+#define DAEMON_IO_TIMEOUT 30
+#define DAEMON_STOP_POLL_MS 200
+
+typedef struct {
+    int fd;
+    struct timeval queued;  /* istante dell'accept */
+} DaemonJob;
+
+/* Coda circolare limitata delle connessioni in attesa di un worker. */
+typedef struct {
+    DaemonJob *jobs;
+    int cap, head, len;
+    int closed;
+    pthread_mutex_t lock;
+    pthread_cond_t not_empty, not_full;
+    const BuildOptions *opt;
+    unsigned long next_request;
+} DaemonQueue;
+
+/* Buffer di un worker, riusati per tutte le sue richieste. */
+typedef struct {
+    FastGraph g;
+    igraph_vector_int_t edge_list;
+} DaemonWorker;
+
+static volatile sig_atomic_t daemon_stop = 0;
+
+static void daemon_on_signal(int sig) {
+    (void) sig;
+    daemon_stop = 1;
+}
+
+static double elapsed_ms(const struct timeval *a, const struct timeval *b) {
+    return ((b->tv_sec - a->tv_sec) * 1000000 + (b->tv_usec - a->tv_usec)) / 1e3;
+}
+
+/* Accoda una connessione; restituisce 1, senza accodarla, se durante l'attesa
+   di un posto libero arriva l'arresto. L'attesa è a tempo perché il gestore del
+   segnale può solo impostare daemon_stop, non risvegliare la condizione. */
+static int daemon_push(DaemonQueue *q, DaemonJob job) {
+    pthread_mutex_lock(&q->lock);
+    while (q->len == q->cap && !daemon_stop) {
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_nsec += DAEMON_STOP_POLL_MS * 1000000L;
+        deadline.tv_sec += deadline.tv_nsec / 1000000000L;
+        deadline.tv_nsec %= 1000000000L;
+        pthread_cond_timedwait(&q->not_full, &q->lock, &deadline);
+    }
+    if (q->len == q->cap) {
+        pthread_mutex_unlock(&q->lock);
+        return 1;
+    }
+    q->jobs[(q->head + q->len) % q->cap] = job;
+    q->len++;
+    pthread_cond_signal(&q->not_empty);
+    pthread_mutex_unlock(&q->lock);
+    return 0;
+}
+
+/* Estrae la prossima connessione; restituisce 1 se la coda è chiusa e vuota. */
+static int daemon_pop(DaemonQueue *q, DaemonJob *job) {
+    pthread_mutex_lock(&q->lock);
+    while (q->len == 0 && !q->closed)
+        pthread_cond_wait(&q->not_empty, &q->lock);
+    if (q->len == 0) {
+        pthread_mutex_unlock(&q->lock);
+        return 1;
+    }
+    *job = q->jobs[q->head];
+    q->head = (q->head + 1) % q->cap;
+    q->len--;
+    pthread_cond_signal(&q->not_full);
+    pthread_mutex_unlock(&q->lock);
+    return 0;
+}
+
+/* daemon_serve:
+   Serve le richieste di una connessione (in_fp / out_fp) fino alla fine dello
+   stream o al primo errore. queued è l'istante in cui la connessione è entrata in coda.
+*/
+static void daemon_serve(DaemonQueue *q, DaemonWorker *w, FILE *in_fp, FILE *out_fp,
+                         const struct timeval *queued) {
+    struct timeval t_start = *queued;
+    for (;;) {
+        /* Salta gli spazi tra una richiesta e l'altra; la fine dello stream chiude la connessione */
+        int c;
+        while ((c = getc(in_fp)) != EOF && (c == '\n' || c == '\r' || c == ' ' || c == '\t'))
+            ;
+        if (c == EOF) {
+            if (ferror(in_fp))
+                fprintf(stderr, "[demone] connessione chiusa: nessun dato per %d s\n", DAEMON_IO_TIMEOUT);
+            break;
+        }
+        ungetc(c, in_fp);
+
+        unsigned long id = __atomic_add_fetch(&q->next_request, 1, __ATOMIC_RELAXED);
+        char src[32];
+        snprintf(src, sizeof(src), "richiesta %lu", id);
+        struct timeval t0, t1, t2, t3;
+        gettimeofday(&t0, NULL);
+        JdmInput in;
+        /* Un timeout a metà richiesta sembrerebbe la fine dello stream: la JDM
+           letta fin lì sarebbe incompleta e non va costruita */
+        if (load_nkk_stream(in_fp, src, &in) != 0 || ferror(in_fp)) {
+            fprintf(out_fp, "# errore JDM non valida (%s)\n", src);
+            fflush(out_fp);
+            jdm_input_destroy(&in);
+            fprintf(stderr, "[demone] %s: JDM non valida, connessione chiusa\n", src);
+            break;
+        }
+        gettimeofday(&t1, NULL);
+        igraph_vector_int_clear(&w->edge_list);
+        int build_err = joint_degree_model(&in, q->opt, &w->g, &w->edge_list);
+        gettimeofday(&t2, NULL);
+        /* Un grafo incompleto non viene inviato: solo la riga di errore */
+        long E = build_err ? 0 : write_graph_stream(out_fp, &w->g, 1);  // i worker del demone sono già in parallelo
+        if (build_err)
+            fprintf(out_fp, "# errore costruzione non riuscita\n");
+        else if (E == in.total_edges)
+            fprintf(out_fp, "# ok nodi=%" PRI_NODE " archi=%ld ms=%.3f\n", in.total_nodes, E, elapsed_ms(&t0, &t2));
+        else
+            fprintf(out_fp, "# errore archi=%ld attesi=%" PRI_EDGE "\n", E, in.total_edges);
+        int send_err = fflush(out_fp) != 0;
+        gettimeofday(&t3, NULL);
+        fprintf(stderr, "[demone] %s: %" PRI_NODE " nodi, %ld archi, coda %.2f ms, lettura %.2f ms, "
+                        "costruzione %.2f ms, invio %.2f ms, totale %.2f ms\n",
+                src, in.total_nodes, E, elapsed_ms(&t_start, &t0), elapsed_ms(&t0, &t1),
+                elapsed_ms(&t1, &t2), elapsed_ms(&t2, &t3), elapsed_ms(&t_start, &t3));
+        jdm_input_destroy(&in);
+        if (send_err || build_err) break;
+        /* Le richieste successive sulla stessa connessione non passano dalla coda */
+        gettimeofday(&t_start, NULL);
+    }
+}
+
+static void daemon_worker_init(DaemonWorker *w) {
+    memset(&w->g, 0, sizeof(w->g));
+    igraph_vector_int_init(&w->edge_list, 0);
+}
+
+static void daemon_worker_destroy(DaemonWorker *w) {
+    fastgraph_destroy(&w->g);
+    igraph_vector_int_destroy(&w->edge_list);
+}
+
+static void *daemon_worker(void *arg) {
+    DaemonQueue *q = arg;
+    DaemonWorker w;
+    daemon_worker_init(&w);
+    DaemonJob job;
+    while (daemon_pop(q, &job) == 0) {
+        /* Lettura e scrittura bufferizzate separate sullo stesso socket */
+        FILE *in_fp = fdopen(job.fd, "r");
+        int out_fd = in_fp ? dup(job.fd) : -1;
+        FILE *out_fp = out_fd >= 0 ? fdopen(out_fd, "w") : NULL;
+        if (!out_fp) {
+            perror("fdopen");
+            if (out_fd >= 0) close(out_fd);
+            if (in_fp) fclose(in_fp);
+            else close(job.fd);
+            continue;
+        }
+        daemon_serve(q, &w, in_fp, out_fp, &job.queued);
+        fclose(out_fp);
+        fclose(in_fp);
+    }
+    daemon_worker_destroy(&w);
+    return NULL;
+}
+
+/* daemon_main:
+   Serve le richieste su socket_path con n_workers worker e una coda di
+   queue_cap connessioni; con socket_path "-" serve un'unica sessione su
+   stdin/stdout. Termina con SIGINT/SIGTERM dopo aver servito le connessioni in coda.
+*/
+static int daemon_main(const char *socket_path, int n_workers, int queue_cap, const BuildOptions *opt) {
+    /* Un client che chiude in anticipo non deve terminare il demone */
+    signal(SIGPIPE, SIG_IGN);
+    DaemonQueue q;
+    memset(&q, 0, sizeof(q));
+    q.opt = opt;
+
+    if (strcmp(socket_path, "-") == 0) {
+        /* stdout resta agli archi: i messaggi della costruzione vanno su stderr */
+        fflush(stdout);
+        int out_fd = dup(STDOUT_FILENO);
+        FILE *out_fp = out_fd >= 0 ? fdopen(out_fd, "w") : NULL;
+        if (!out_fp || dup2(STDERR_FILENO, STDOUT_FILENO) < 0) {
+            perror("dup");
+            return 1;
+        }
+        DaemonWorker w;
+        daemon_worker_init(&w);
+        struct timeval now;
+        gettimeofday(&now, NULL);
+        daemon_serve(&q, &w, stdin, out_fp, &now);
+        daemon_worker_destroy(&w);
+        fclose(out_fp);
+        return 0;
+    }
+
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (strlen(socket_path) >= sizeof(addr.sun_path)) {
+        fprintf(stderr, "Errore: percorso del socket troppo lungo: %s\n", socket_path);
+        return 1;
+    }
+    strcpy(addr.sun_path, socket_path);
+    int lfd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (lfd < 0) {
+        perror("socket");
+        return 1;
+    }
+    unlink(socket_path);
+    if (bind(lfd, (struct sockaddr *) &addr, sizeof(addr)) != 0 || listen(lfd, queue_cap) != 0) {
+        perror(socket_path);
+        close(lfd);
+        return 1;
+    }
+
+    q.cap = queue_cap;
+    q.jobs = malloc(queue_cap * sizeof(DaemonJob));
+    pthread_t *threads = malloc(n_workers * sizeof(pthread_t));
+    if (!q.jobs || !threads) {
+        fprintf(stderr, "Errore: impossibile allocare la coda del demone\n");
+        close(lfd);
+        return 1;
+    }
+    pthread_mutex_init(&q.lock, NULL);
+    pthread_cond_init(&q.not_empty, NULL);
+    pthread_cond_init(&q.not_full, NULL);
+
+    /* I segnali di arresto arrivano solo al thread che esegue accept */
+    sigset_t stop_set, old_set;
+    sigemptyset(&stop_set);
+    sigaddset(&stop_set, SIGINT);
+    sigaddset(&stop_set, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &stop_set, &old_set);
+    int started = 0;
+    while (started < n_workers && pthread_create(&threads[started], NULL, daemon_worker, &q) == 0)
+        started++;
+    pthread_sigmask(SIG_SETMASK, &old_set, NULL);
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = daemon_on_signal;  /* senza SA_RESTART: accept si interrompe */
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+
+    if (started == 0) {
+        perror("pthread_create");
+        daemon_stop = 1;
+    } else {
+        fprintf(stderr, "[demone] in ascolto su %s (%d worker, coda %d, motore %s)\n",
+                socket_path, started, queue_cap, opt->engine == ENGINE_BUCKET ? "bucket" : "sampling");
+    }
+    while (!daemon_stop) {
+        int fd = accept(lfd, NULL, NULL);
+        if (fd < 0) {
+            if (errno == EINTR) continue;
+            perror("accept");
+            break;
+        }
+        struct timeval io_timeout = { DAEMON_IO_TIMEOUT, 0 };
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &io_timeout, sizeof(io_timeout));
+        setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &io_timeout, sizeof(io_timeout));
+        DaemonJob job;
+        job.fd = fd;
+        gettimeofday(&job.queued, NULL);
+        if (daemon_push(&q, job) != 0) {
+            close(fd);
+            break;
+        }
+    }
+
+    pthread_mutex_lock(&q.lock);
+    q.closed = 1;
+    pthread_cond_broadcast(&q.not_empty);
+    pthread_mutex_unlock(&q.lock);
+    for (int t = 0; t < started; t++)
+        pthread_join(threads[t], NULL);
+    close(lfd);
+    unlink(socket_path);
+    fprintf(stderr, "[demone] arrestato dopo %lu richieste\n", q.next_request);
+
+    pthread_mutex_destroy(&q.lock);
+    pthread_cond_destroy(&q.not_empty);
+    pthread_cond_destroy(&q.not_full);
+    free(threads);
+    free(q.jobs);
+    return started == 0 ? 1 : 0;
+}
+
+/* ===============================
+   8b) Costruzione a shard (più processi)
+   =============================== */
+
+/* Con -S n ibrido divide il motore bucket fra n processi shard, coordinati dal
+   processo iniziale attraverso socket Unix (socketpair):
+   - le classi di grado, ordinate per grado, sono divise in n intervalli
+     contigui di nodi con circa lo stesso numero di stub: lo shard s possiede
+     i nodi e la permutazione delle proprie classi;
+   - il coordinatore legge la JDM, calcola gli offset di riga delle celle
+     (bucket_cells) e manda a ogni shard il suo lavoro: la tabella delle classi
+     e i blocchi (k,l), k >= l, che deve generare, con almeno una delle due
+     classi posseduta dallo shard;
+   - lo shard riempie i blocchi con lo schema di bucket_fill. Un estremo in una
+     classe di un altro shard è noto solo come slot (first + posizione nella
+     classe): lo shard accoda la coppia (v, slot) in un lotto per il
+     proprietario, il coordinatore inoltra il lotto e il proprietario risolve
+     lo slot con la propria permutazione e scrive l'arco;
+   - ogni shard scrive la propria parte in <file>.<s> (righe "u,v"), senza
+     passare dal coordinatore, che tiene solo la JDM: memoria e CPU si
+     dividono fra gli shard.
+   Ogni shard ha un thread che riceve i lotti mentre il principale genera, il
+   coordinatore un thread di inoltro per shard: nessuno smette mai di leggere,
+   quindi un socket pieno non porta a uno stallo. Gli shard usano solo ciò che
+   ricevono dal socket, così potrebbero girare su un'altra macchina; i messaggi
+   sono per ora nell'ordine dei byte locale.
+*/
+#define SHARD_BATCH_PAIRS 8192
+
+typedef enum {
+    SHARD_MSG_JOB,    // coordinatore -> shard: ShardJob, classi, blocchi
+    SHARD_MSG_PAIRS,  // lotto di count coppie (v, slot) per lo shard to
+    SHARD_MSG_DONE,   // shard -> coordinatore: blocchi finiti, lotti spediti
+    SHARD_MSG_END,    // coordinatore -> shard: non arrivano altri lotti
+    SHARD_MSG_STATS   // shard -> coordinatore: count archi scritti, to = esito
+} ShardMsgType;
+
+/* Intestazione di ogni messaggio, seguita da bytes byte di contenuto. */
+typedef struct {
+    uint32_t type;
+    int32_t to;
+    uint64_t count;
+    uint64_t bytes;
+} ShardMsg;
+
+typedef struct {
+    int shard, n_shards;
+    unsigned seed;
+    int n_classes, n_blocks;
+    jdm_node_t lo, hi;  // nodi dello shard
+} ShardJob;
+
+typedef struct {
+    int degree, owner;
+    jdm_node_t first, count;
+} ShardClass;
+
+/* Blocco (k,l), k >= l: val archi, a partire dagli offset di riga start_k e start_l. */
+typedef struct {
+    int k, l;
+    jdm_edge_t val, start_k, start_l;
+} ShardBlock;
+
+/* Scrive/legge esattamente len byte; 0 se riuscito. send con MSG_NOSIGNAL:
+   uno shard terminato dà un errore e non un SIGPIPE. */
+static int shard_write(int fd, const void *buf, size_t len) {
+    const char *p = buf;
+    while (len > 0) {
+        ssize_t n = send(fd, p, len, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return 1;
+        p += n;
+        len -= (size_t) n;
+    }
+    return 0;
+}
+
+static int shard_read(int fd, void *buf, size_t len) {
+    char *p = buf;
+    while (len > 0) {
+        ssize_t n = read(fd, p, len);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return 1;
+        p += n;
+        len -= (size_t) n;
+    }
+    return 0;
+}
+
+static int shard_send(int fd, ShardMsgType type, int to, uint64_t count, const void *data, size_t bytes) {
+    ShardMsg m = { (uint32_t) type, to, count, bytes };
+    return shard_write(fd, &m, sizeof(m)) || (bytes > 0 && shard_write(fd, data, bytes));
+}
+
+/* ---- lato shard ---- */
+
+/* Parte su file di uno shard: la scrivono il thread principale e il ricevitore
+   (le chiamate stdio sullo stesso FILE sono serializzate). */
+typedef struct {
+    FILE *out;
+    long edges;
+} ShardOutput;
+
+static int shard_emit(void *ctx, jdm_node_t v, jdm_node_t w) {
+    ShardOutput *o = ctx;
+    if (fprintf(o->out, "%" PRI_NODE ",%" PRI_NODE "\n", v, w) < 0) return 1;
+    o->edges++;
+    return 0;
+}
+
+typedef struct {
+    int fd;
+    const jdm_node_t *perm;  // permutazione dei nodi lo..hi-1, indicizzata da slot - lo
+    jdm_node_t lo, hi;
+    ShardOutput out;
+    int err;
+} ShardReceiver;
+
+/* Thread ricevitore: risolve i lotti degli altri shard fino a SHARD_MSG_END. */
+static void *shard_receiver(void *arg) {
+    ShardReceiver *r = arg;
+    jdm_node_t *pairs = malloc(2 * SHARD_BATCH_PAIRS * sizeof(jdm_node_t));
+    ShardMsg m;
+    while (pairs && shard_read(r->fd, &m, sizeof(m)) == 0) {
+        if (m.type == SHARD_MSG_END) {
+            free(pairs);
+            return NULL;
+        }
+        if (m.type != SHARD_MSG_PAIRS || m.count > SHARD_BATCH_PAIRS
+            || m.bytes != m.count * 2 * sizeof(jdm_node_t) || shard_read(r->fd, pairs, m.bytes) != 0)
+            break;
+        for (uint64_t i = 0; i < m.count; i++) {
+            jdm_node_t v = pairs[2 * i], slot = pairs[2 * i + 1];
+            if (slot < r->lo || slot >= r->hi || shard_emit(&r->out, v, r->perm[slot - r->lo]) != 0)
+                r->err = 1;
+        }
+    }
+    free(pairs);
+    r->err = 1;
+    return NULL;
+}
+
+/* Lotti in uscita, uno per shard destinatario. */
+typedef struct {
+    int fd;
+    jdm_node_t *pairs;  // n_shards * 2 * SHARD_BATCH_PAIRS
+    int *len;
+    int err;
+} ShardBatches;
+
+static void shard_flush(ShardBatches *b, int to) {
+    jdm_node_t *p = b->pairs + (size_t) to * 2 * SHARD_BATCH_PAIRS;
+    if (b->len[to] > 0 && shard_send(b->fd, SHARD_MSG_PAIRS, to, (uint64_t) b->len[to], p,
+                                     (size_t) b->len[to] * 2 * sizeof(jdm_node_t)) != 0)
+        b->err = 1;
+    b->len[to] = 0;
+}
+
+static void shard_push(ShardBatches *b, int to, jdm_node_t v, jdm_node_t slot) {
+    jdm_node_t *p = b->pairs + (size_t) to * 2 * SHARD_BATCH_PAIRS + 2 * b->len[to];
+    p[0] = v;
+    p[1] = slot;
+    if (++b->len[to] == SHARD_BATCH_PAIRS) shard_flush(b, to);
+}
+
+/* shard_run:
+   Processo shard sul socket fd: riceve il lavoro, riempie i propri blocchi
+   scrivendo in <out_prefix>.<shard> e risolve i lotti degli altri shard.
+   Restituisce lo stato di uscita del processo.
+*/
+static int shard_run(int fd, const char *out_prefix) {
+    ShardMsg m;
+    if (shard_read(fd, &m, sizeof(m)) != 0 || m.type != SHARD_MSG_JOB || m.bytes < sizeof(ShardJob))
+        return 1;
+    Arena arena;
+    arena_init(&arena, 0);
+    char *payload = arena_alloc(&arena, m.bytes);
+    ShardJob job;
+    if (!payload || shard_read(fd, payload, m.bytes) != 0) {
+        arena_release(&arena);
+        return 1;
+    }
+    memcpy(&job, payload, sizeof(job));
+    const ShardClass *classes = (const ShardClass *) (payload + sizeof(job));
+    const ShardBlock *blocks = (const ShardBlock *) (classes + job.n_classes);
+    if (m.bytes != sizeof(job) + job.n_classes * sizeof(ShardClass) + job.n_blocks * sizeof(ShardBlock)) {
+        arena_release(&arena);
+        return 1;
+    }
+    int max_degree = 0;
+    for (int c = 0; c < job.n_classes; c++)
+        if (classes[c].degree > max_degree) max_degree = classes[c].degree;
+    const ShardClass **class_of = arena_calloc(&arena, max_degree + 1, sizeof(ShardClass *));
+    jdm_node_t *perm = arena_alloc(&arena, ((size_t) (job.hi - job.lo) + 1) * sizeof(jdm_node_t));
+    ShardBatches batches = { fd, NULL, NULL, 0 };
+    batches.pairs = arena_alloc(&arena, (size_t) job.n_shards * 2 * SHARD_BATCH_PAIRS * sizeof(jdm_node_t));
+    batches.len = arena_calloc(&arena, job.n_shards, sizeof(int));
+    char fname[4096];
+    snprintf(fname, sizeof(fname), "%s.%d", out_prefix, job.shard);
+    FILE *out = fopen(fname, "w");
+    if (!class_of || !perm || !batches.pairs || !batches.len || !out) {
+        fprintf(stderr, "Errore: shard %d: impossibile preparare %s\n", job.shard, fname);
+        if (out) fclose(out);
+        arena_release(&arena);
+        return 1;
+    }
+    setvbuf(out, NULL, _IOFBF, 1 << 20);
+
+    /* Permutazione casuale dei nodi dentro ogni classe posseduta */
+    srand(job.seed + (unsigned) job.shard);
+    for (jdm_node_t v = job.lo; v < job.hi; v++) perm[v - job.lo] = v;
+    for (int c = 0; c < job.n_classes; c++) {
+        class_of[classes[c].degree] = &classes[c];
+        if (classes[c].owner != job.shard) continue;
+        jdm_node_t *p = perm + (classes[c].first - job.lo);
+        for (jdm_node_t i = classes[c].count - 1; i > 0; i--) {
+            jdm_node_t j = rand_below(i + 1);
+            jdm_node_t t = p[i];
+            p[i] = p[j];
+            p[j] = t;
+        }
+    }
+
+    ShardReceiver rcv = { fd, perm, job.lo, job.hi, { out, 0 }, 0 };
+    pthread_t rcv_thread;
+    if (pthread_create(&rcv_thread, NULL, shard_receiver, &rcv) != 0) {
+        perror("pthread_create");
+        fclose(out);
+        arena_release(&arena);
+        return 1;
+    }
+    ShardOutput local = { out, 0 };
+    int err = 0;
+    for (int b = 0; b < job.n_blocks && !err; b++) {
+        const ShardBlock *blk = &blocks[b];
+        const ShardClass *a = blk->k <= max_degree ? class_of[blk->k] : NULL;
+        const ShardClass *c = blk->l <= max_degree ? class_of[blk->l] : NULL;
+        if (!a || !c || (a->owner != job.shard && c->owner != job.shard)) {
+            err = 1;
+            break;
+        }
+        jdm_node_t na = a->count, nc = c->count;
+        if (blk->k == blk->l) {
+            /* Blocco diagonale: tutto locale, con first relativo alla permutazione dello shard */
+            DegreeClass cls = { a->degree, a->first - job.lo, na };
+            err = bucket_fill_diagonal(shard_emit, &local, perm, &cls, blk->start_k, blk->val, &arena) < 0;
+            continue;
+        }
+        /* Stesso accoppiamento a rotazione di bucket_fill, sugli slot: lo shard ne
+           possiede almeno uno, l'altro (se remoto) va in un lotto al proprietario */
+        int qa = (int) (blk->val / na);
+        jdm_node_t ra = (jdm_node_t) (blk->val % na);
+        jdm_edge_t j = 0;
+        for (jdm_node_t x = 0; x < (qa > 0 ? na : ra) && !err; x++) {
+            jdm_node_t slot_a = a->first + (jdm_node_t) ((blk->start_k + x) % na);
+            for (int t = qa + (x < ra); t > 0; t--, j++) {
+                jdm_node_t slot_c = c->first + (jdm_node_t) ((blk->start_l + j) % nc);
+                if (a->owner != job.shard)
+                    shard_push(&batches, a->owner, perm[slot_c - job.lo], slot_a);
+                else if (c->owner != job.shard)
+                    shard_push(&batches, c->owner, perm[slot_a - job.lo], slot_c);
+                else
+                    err |= shard_emit(&local, perm[slot_a - job.lo], perm[slot_c - job.lo]);
+            }
+        }
+    }
+    for (int s = 0; s < job.n_shards; s++)
+        shard_flush(&batches, s);
+    /* DONE anche dopo un errore: il coordinatore deve poter chiudere gli altri shard */
+    if (shard_send(fd, SHARD_MSG_DONE, job.shard, 0, NULL, 0) != 0) err = 1;
+    pthread_join(rcv_thread, NULL);
+    if (fclose(out) != 0) err = 1;
+    err |= batches.err | rcv.err;
+    if (err) fprintf(stderr, "Errore: lo shard %d non ha completato %s\n", job.shard, fname);
+    shard_send(fd, SHARD_MSG_STATS, err, (uint64_t) (local.edges + rcv.out.edges), NULL, 0);
+    arena_release(&arena);
+    return err;
+}
+
+/* ---- lato coordinatore ---- */
+
+typedef struct ShardCoordinator ShardCoordinator;
+
+/* Collegamento del coordinatore con uno shard: lock serializza le scritture
+   sul socket (inoltri degli altri thread e SHARD_MSG_END). */
+typedef struct {
+    ShardCoordinator *co;
+    int fd;
+    pid_t pid;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    long edges;
+    int done, failed;
+} ShardLink;
+
+struct ShardCoordinator {
+    ShardLink *links;
+    int n_shards;
+    int n_done;
+    pthread_mutex_t lock;
+    pthread_cond_t all_done;
+};
+
+static void shard_mark_done(ShardLink *link) {
+    ShardCoordinator *co = link->co;
+    pthread_mutex_lock(&co->lock);
+    if (!link->done) {
+        link->done = 1;
+        if (++co->n_done == co->n_shards) pthread_cond_signal(&co->all_done);
+    }
+    pthread_mutex_unlock(&co->lock);
+}
+
+/* Thread di inoltro: legge i messaggi di uno shard e inoltra i lotti al destinatario. */
+static void *shard_forwarder(void *arg) {
+    ShardLink *link = arg;
+    ShardCoordinator *co = link->co;
+    jdm_node_t *pairs = malloc(2 * SHARD_BATCH_PAIRS * sizeof(jdm_node_t));
+    ShardMsg m;
+    int lost = 0;  /* lotti non consegnati: si continua a leggere, perché lo shard non si blocchi */
+    link->failed = 1;
+    while (pairs && shard_read(link->fd, &m, sizeof(m)) == 0) {
+        if (m.type == SHARD_MSG_DONE) {
+            shard_mark_done(link);
+            continue;
+        }
+        if (m.type == SHARD_MSG_STATS) {
+            link->edges = (long) m.count;
+            link->failed = m.to != 0 || lost;
+            break;
+        }
+        if (m.type != SHARD_MSG_PAIRS || m.to < 0 || m.to >= co->n_shards || m.count > SHARD_BATCH_PAIRS
+            || m.bytes != m.count * 2 * sizeof(jdm_node_t) || shard_read(link->fd, pairs, m.bytes) != 0)
+            break;
+        ShardLink *dest = &co->links[m.to];
+        pthread_mutex_lock(&dest->lock);
+        lost |= shard_send(dest->fd, SHARD_MSG_PAIRS, m.to, m.count, pairs, m.bytes);
+        pthread_mutex_unlock(&dest->lock);
+    }
+    free(pairs);
+    /* Uno shard caduto prima di DONE conta come finito, altrimenti gli altri aspettano END per sempre */
+    shard_mark_done(link);
+    return NULL;
+}
+
+/* Divide le classi (ordinate per grado) in intervalli contigui di nodi con
+   circa lo stesso numero di stub: ogni classe va allo shard in cui cade il suo
+   stub centrale. */
+static void shard_assign_classes(ShardClass *classes, int n_classes, int n_shards) {
+    int64_t total = 0, before = 0;
+    for (int c = 0; c < n_classes; c++)
+        total += (int64_t) classes[c].degree * classes[c].count;
+    for (int c = 0; c < n_classes; c++) {
+        int64_t stubs = (int64_t) classes[c].degree * classes[c].count;
+        int owner = total > 0 ? (int) ((double) (before + stubs / 2) * n_shards / (double) total) : 0;
+        classes[c].owner = owner < n_shards ? owner : n_shards - 1;
+        before += stubs;
+    }
+}
+
+static int cmp_shard_class(const void *a, const void *b) {
+    const ShardClass *x = a, *y = b;
+    return (x->degree > y->degree) - (x->degree < y->degree);
+}
+
+/* shard_main:
+   Coordinatore di -S: prepara classi e blocchi, avvia n_shards processi shard,
+   inoltra i lotti fra di loro e raccoglie gli archi scritti in <out_prefix>.<s>.
+*/
+static int shard_main(const JdmInput *in, int n_shards, unsigned seed, const char *out_prefix) {
+    if (!is_valid_joint_degree(in)) {
+        printf("La distribuzione nkk non è realizzabile come grafo semplice.\n");
+        return 1;
+    }
+    struct timeval tp1, tp2;
+    gettimeofday(&tp1, NULL);
+    Arena arena;
+    arena_init(&arena, 0);
+
+    /* Classi ordinate per grado, con id consecutivi, e shard proprietario */
+    int n_classes = 0;
+    ShardClass *classes = arena_alloc(&arena, (g_hash_table_size(in->nk) + 1) * sizeof(ShardClass));
+    int n_cells;
+    RowCell *cells = bucket_cells(in, &n_cells, &arena);
+    ShardLink *links = arena_calloc(&arena, n_shards, sizeof(ShardLink));
+    int *n_blocks = arena_calloc(&arena, n_shards, sizeof(int));
+    ShardBlock *blocks = arena_alloc(&arena, (n_cells + 1) * sizeof(ShardBlock));
+    if (!classes || !cells || !links || !n_blocks || !blocks) {
+        fprintf(stderr, "Errore: memoria esaurita preparando gli shard\n");
+        arena_release(&arena);
+        return 1;
+    }
+    GHashTableIter iter;
+    gpointer key, value;
+    g_hash_table_iter_init(&iter, in->nk);
+    while (g_hash_table_iter_next(&iter, &key, &value)) {
+        classes[n_classes].degree = (int) JDM_FROM_POINTER(key);
+        classes[n_classes].count = (jdm_node_t) JDM_FROM_POINTER(value);
+        n_classes++;
+    }
+    qsort(classes, n_classes, sizeof(ShardClass), cmp_shard_class);
+    jdm_node_t first = 0;
+    for (int c = 0; c < n_classes; c++) {
+        classes[c].first = first;
+        first += classes[c].count;
+    }
+    shard_assign_classes(classes, n_classes, n_shards);
+
+    /* Blocchi (k,l), k >= l, e shard che li genera. Gli archi di un blocco locale
+       li scrive il suo shard; quelli di un blocco fra due shard li scrive chi
+       risolve i lotti, cioè l'altro: il coordinatore sceglie come scrittore lo
+       shard con meno archi finora, perché le parti abbiano dimensioni simili. */
+    int *block_owner = arena_alloc(&arena, (n_cells + 1) * sizeof(int));
+    int *block_other = arena_alloc(&arena, (n_cells + 1) * sizeof(int));
+    int64_t *written = arena_calloc(&arena, n_shards, sizeof(int64_t));
+    int n_total = 0;
+    for (int i = 0; block_owner && block_other && written && i < n_cells; i++) {
+        int k = cells[i].k, l = cells[i].l;
+        if (k < l) continue;
+        ShardClass key_k = { k, 0, 0, 0 }, key_l = { l, 0, 0, 0 };
+        const ShardClass *a = bsearch(&key_k, classes, n_classes, sizeof(ShardClass), cmp_shard_class);
+        const ShardClass *b = bsearch(&key_l, classes, n_classes, sizeof(ShardClass), cmp_shard_class);
+        if (!a || !b) continue;
+        ShardBlock blk = { k, l, cells[i].val, cells[i].off,
+                           k == l ? 0 : row_cell_offset(cells, n_cells, l, k) };
+        blocks[n_total] = blk;
+        block_owner[n_total] = a->owner;
+        block_other[n_total] = b->owner;
+        if (a->owner == b->owner) written[a->owner] += blk.val;
+        n_total++;
+    }
+    for (int i = 0; block_owner && block_other && written && i < n_total; i++) {
+        int x = block_owner[i], y = block_other[i];
+        if (x == y) continue;
+        int writer = written[x] <= written[y] ? x : y;
+        written[writer] += blocks[i].val;
+        block_owner[i] = writer == x ? y : x;
+    }
+    for (int i = 0; block_owner && i < n_total; i++)
+        n_blocks[block_owner[i]]++;
+    size_t job_bytes_max = sizeof(ShardJob) + n_classes * sizeof(ShardClass) + n_total * sizeof(ShardBlock);
+    char *job_buf = arena_alloc(&arena, job_bytes_max);
+    if (!block_owner || !block_other || !written || !job_buf) {
+        fprintf(stderr, "Errore: memoria esaurita preparando gli shard\n");
+        arena_release(&arena);
+        return 1;
+    }
+    printf("Costruzione a shard: %d processi, %d classi, %d blocchi\n", n_shards, n_classes, n_total);
+
+    /* Avvio degli shard: ognuno tiene solo la propria estremità del socket */
+    ShardCoordinator co = { links, n_shards, 0, PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER };
+    fflush(stdout);
+    fflush(stderr);
+    int started = 0;
+    for (; started < n_shards; started++) {
+        int sv[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) != 0) {
+            perror("socketpair");
+            break;
+        }
+        pid_t pid = fork();
+        if (pid < 0) {
+            perror("fork");
+            close(sv[0]);
+            close(sv[1]);
+            break;
+        }
+        if (pid == 0) {
+            close(sv[0]);
+            for (int s = 0; s < started; s++) close(links[s].fd);
+            _exit(shard_run(sv[1], out_prefix));
+        }
+        close(sv[1]);
+        links[started].co = &co;
+        links[started].fd = sv[0];
+        links[started].pid = pid;
+        pthread_mutex_init(&links[started].lock, NULL);
+    }
+
+    /* Lavoro di ogni shard: intervallo di nodi, classi, propri blocchi */
+    int err = started < n_shards;
+    for (int s = 0; s < started; s++) {
+        ShardJob job = { s, n_shards, seed, n_classes, n_blocks[s], 0, 0 };
+        int seen = 0;
+        for (int c = 0; c < n_classes; c++) {
+            if (classes[c].owner != s) continue;
+            if (!seen) job.lo = classes[c].first;
+            job.hi = classes[c].first + classes[c].count;
+            seen = 1;
+        }
+        char *p = job_buf;
+        memcpy(p, &job, sizeof(job));
+        p += sizeof(job);
+        memcpy(p, classes, n_classes * sizeof(ShardClass));
+        p += n_classes * sizeof(ShardClass);
+        for (int i = 0; i < n_total; i++) {
+            if (block_owner[i] != s) continue;
+            memcpy(p, &blocks[i], sizeof(ShardBlock));
+            p += sizeof(ShardBlock);
+        }
+        /* Con uno shard mancante il lavoro non parte: gli altri ricevono solo END */
+        if (err || shard_send(links[s].fd, SHARD_MSG_JOB, s, 0, job_buf, (size_t) (p - job_buf)) != 0) {
+            err = 1;
+            break;
+        }
+    }
+    if (err) {
+        for (int s = 0; s < started; s++)
+            close(links[s].fd);
+        for (int s = 0; s < started; s++)
+            waitpid(links[s].pid, NULL, 0);
+        fprintf(stderr, "Errore: impossibile avviare %d shard\n", n_shards);
+        arena_release(&arena);
+        return 1;
+    }
+
+    /* Inoltro dei lotti fino a DONE da tutti gli shard, poi END a ognuno */
+    int n_threads = 0;
+    for (; n_threads < n_shards; n_threads++)
+        if (pthread_create(&links[n_threads].thread, NULL, shard_forwarder, &links[n_threads]) != 0) break;
+    if (n_threads < n_shards) {
+        perror("pthread_create");
+        /* Chiudendo i socket gli shard senza inoltro falliscono e contano come finiti */
+        for (int s = n_threads; s < n_shards; s++) {
+            shutdown(links[s].fd, SHUT_RDWR);
+            links[s].failed = 1;
+            shard_mark_done(&links[s]);
+        }
+    }
+    pthread_mutex_lock(&co.lock);
+    while (co.n_done < n_shards)
+        pthread_cond_wait(&co.all_done, &co.lock);
+    pthread_mutex_unlock(&co.lock);
+    for (int s = 0; s < n_shards; s++) {
+        pthread_mutex_lock(&links[s].lock);
+        shard_send(links[s].fd, SHARD_MSG_END, s, 0, NULL, 0);
+        pthread_mutex_unlock(&links[s].lock);
+    }
+    for (int s = 0; s < n_threads; s++)
+        pthread_join(links[s].thread, NULL);
+
+    long E = 0;
+    for (int s = 0; s < n_shards; s++) {
+        int status;
+        close(links[s].fd);
+        if (waitpid(links[s].pid, &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+            links[s].failed = 1;
+        pthread_mutex_destroy(&links[s].lock);
+        printf("  shard %d: %ld archi in %s.%d%s\n", s, links[s].edges, out_prefix, s,
+               links[s].failed ? " (fallito)" : "");
+        err |= links[s].failed;
+        E += links[s].edges;
+    }
+    gettimeofday(&tp2, NULL);
+    double runtime = ((tp2.tv_sec - tp1.tv_sec) * 1000000 + (tp2.tv_usec - tp1.tv_usec)) / 1e6;
+    printf("#Motore:bucket\n");
+    printf("#Shard:%d\n", n_shards);
+    printf("#Edges:%ld\n", E);
+    printf("#Nodes:%" PRI_NODE "\n", in->total_nodes);
+    printf("Tempo:%.3f secondi\n", runtime);
+    if (!err && E != (long) in->total_edges) {
+        fprintf(stderr, "Errore: gli shard hanno scritto %ld archi su %" PRI_EDGE "\n", E, in->total_edges);
+        err = 1;
+    }
+    arena_release(&arena);
+    return err;
+}
+
+/* ===============================
+   9) Funzione main
+   =============================== */
+
+static void usage(const char *prog) {
+    fprintf(stderr,
+            "Uso: %s [-e motore] [-o ordine] [-s seme] [-f formato] [-p secondi] [-P file] <file.nkk>\n"
+            "     %s [-s seme] [-f formato] -r <esistente.graph> <obiettivo.nkk>\n"
+            "     %s [-e motore] [-o ordine] [-s seme] [-j worker] [-q coda] -d <socket|->\n"
+            "     %s [-s seme] -S shard <file.nkk>\n"
+            "  -e motore  sampling (default: campionamento + neighbor_switch) o\n"
+            "             bucket (quote per blocco, esatto e senza tentativi)\n"
+            "  -o ordine  ordine di riempimento dei blocchi (k,l): hash (default),\n"
+            "             degree, density, ascending\n"
+            "  -s seme    seme del generatore (default: tempo corrente)\n"
+            "  -p secondi avanzamento della costruzione (archi, blocco, velocità, ETA)\n"
+            "             ogni tanti secondi su stderr\n"
+            "  -P file    scrive l'avanzamento in file invece che su stderr (default -p 10)\n"
+            "  -f formato formato di generated.graph: text (default), delta\n"
+            "             (delta + varint), zstd (delta a blocchi zstd, se compilato con ZSTD=1)\n"
+            "             o csr (adiacenza da mappare con mmap)\n"
+            "  -d socket  modalità demone su un socket Unix (\"-\": stdin/stdout)\n"
+            "  -j worker  costruzioni in parallelo del demone (default: numero di CPU)\n"
+            "  -q coda    connessioni in attesa al massimo (default: %d)\n"
+            "  -S shard   motore bucket diviso fra shard processi, ognuno scrive\n"
+            "             la propria parte in generated.graph.<i> (formato text)\n",
+            prog, prog, prog, prog, DAEMON_QUEUE_DEFAULT);
+}
+
+int ibrido_main(int argc, char *argv[]) {
+    unsigned seed = (unsigned) time(NULL);
+    char *repair_graph_fname = NULL;
+    char *socket_path = NULL;
+    long n_workers = sysconf(_SC_NPROCESSORS_ONLN);
+    if (n_workers < 1) n_workers = 1;
+    int queue_cap = DAEMON_QUEUE_DEFAULT;
+    BuildOptions opt = { ORDER_HASH, ENGINE_SAMPLING, NULL };
+    GraphFormat format = GRAPH_TEXT;
+    double progress_interval = 0;
+    char *status_path = NULL;
+    int n_shards = 0;
+    int build_flags = 0;  /* -e, -o, -p, -P, -j, -q: non hanno effetto con -r */
+    int c;
+    while ((c = getopt(argc, argv, "r:e:o:s:f:p:P:d:j:q:S:h")) != -1) {
+        if (strchr("eopPjq", c)) build_flags = 1;
+        switch (c) {
+        case 'S': n_shards = atoi(optarg); break;
+        case 'p': progress_interval = atof(optarg); break;
+        case 'P': status_path = optarg; break;
+        case 'r': repair_graph_fname = optarg; break;
+        case 'f':
+            if (parse_graph_format(optarg, &format) != 0) {
+                usage(argv[0]);
+                return 1;
+            }
+            break;
+        case 'd': socket_path = optarg; break;
+        case 'j': n_workers = strtol(optarg, NULL, 10); break;
+        case 'q': queue_cap = atoi(optarg); break;
+        case 'e':
+            if (parse_build_engine(optarg, &opt.engine) != 0) {
+                usage(argv[0]);
+                return 1;
+            }
+            break;
+        case 'o':
+            if (parse_block_order(optarg, &opt.order) != 0) {
+                usage(argv[0]);
+                return 1;
+            }
+            break;
+        case 's': seed = (unsigned) strtoul(optarg, NULL, 10); break;
+        default:  usage(argv[0]); return 1;
+        }
+    }
+    if (n_shards < 0 || (n_shards > 0 && (socket_path || repair_graph_fname || format != GRAPH_TEXT))) {
+        usage(argv[0]);
+        return 1;
+    }
+    if (repair_graph_fname && build_flags) {
+        fprintf(stderr, "Errore: con -r si possono usare solo -s e -f\n");
+        usage(argv[0]);
+        return 1;
+    }
+    if (socket_path) {
+        if (n_workers < 1 || queue_cap < 1 || repair_graph_fname || optind < argc) {
+            usage(argv[0]);
+            return 1;
+        }
+        srand(seed);
+        return daemon_main(socket_path, (int) n_workers, queue_cap, &opt);
+    }
+    if (optind >= argc) {
+        usage(argv[0]);
+        return 1;
+    }
+    srand(seed);
+    int repair_mode = repair_graph_fname != NULL;
+    char *fname = argv[optind];
+
+    /* Legge e valida la JDM in una sola passata: nkk, nk e totali. */
+    JdmInput in;
+    if (load_nkk(fname, &in) != 0) {
+        jdm_input_destroy(&in);
+        return 1;
+    }
+
+    if (repair_mode)
+        return repair_main(repair_graph_fname, &in, format);
+
+    if (n_shards > 0) {
+        int err = shard_main(&in, n_shards, seed, "generated.graph");
+        jdm_input_destroy(&in);
+        return err;
+    }
+
+    printf("Esecuzione della costruzione\n");
+    struct timeval tp1, tp2;
+    gettimeofday(&tp1, NULL);
+
+    /* Prepara l'edge list igraph: si stima (o si lascia espandere) la capacità dinamica */
+    igraph_vector_int_t edge_list;
+    igraph_vector_int_init(&edge_list, 0);  // inizialmente vuoto
+
+    /* Costruisce il grafo e accumula gli archi in edge_list */
+    FastGraph fast_g = { 0 };
+    BuildProgress progress;
+    ProgressReporter *reporter = NULL;
+    if (progress_interval > 0 || status_path) {
+        opt.progress = &progress;
+        reporter = progress_start(&progress, progress_interval > 0 ? progress_interval : 10, status_path);
+    }
+    int build_err = joint_degree_model(&in, &opt, &fast_g, &edge_list);
+    progress_stop(reporter);
+    if (build_err) {
+        fprintf(stderr, "Errore: costruzione non riuscita, generated.graph non viene scritto.\n");
+        fastgraph_destroy(&fast_g);
+        igraph_vector_int_destroy(&edge_list);
+        jdm_input_destroy(&in);
+        return 1;
+    }
+
+    gettimeofday(&tp2, NULL);
+    double runtime = ((tp2.tv_sec - tp1.tv_sec) * 1000000 + (tp2.tv_usec - tp1.tv_usec)) / 1e6;
+    printf("Tempo:%.3f secondi\n", runtime);
+
+    /* Converte il FastGraph in un grafo igraph usando l'edge list accumulata */
+    igraph_t ig_graph;
+    convert_to_igraph(&fast_g, &ig_graph, &edge_list);
+    printf("Grafo igraph creato con %ld nodi.\n", (long) igraph_vcount(&ig_graph));
+
+    /* Scrive il grafo su file in formato edge list. */
+    int write_err = write_graph("generated.graph", &fast_g, format);
+    if (!write_err)
+        printf("Grafo 'generated.graph' generato in formato edge list\n");
+
+    /* Pulizia finale. */
+    fastgraph_destroy(&fast_g);
+    igraph_vector_int_destroy(&edge_list);
+    jdm_input_destroy(&in);
+
+    igraph_destroy(&ig_graph);
+
+    return write_err ? 1 : 0;
+}
+
+#ifndef JDM_LIBRARY
+int main(int argc, char *argv[]) {
+    return ibrido_main(argc, argv);
 }
+#endif
@@ -0,0 +1,195 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include "jdm.h"
+
+/* ===============================
+   jdm: driver a comandi multipli
+   =============================== */
+
+/* Ogni comando riusa il main dello strumento corrispondente (da libjdm.a);
+   "pipeline" collega generazione, costruzione e verifica in memoria, senza
+   serializzare la JDM e il grafo su file intermedi.
+*/
+
+static int pipeline_main(int argc, char *argv[]);
+
+typedef struct {
+    const char *name;
+    int (*run)(int argc, char *argv[]);
+    const char *help;
+} Command;
+
+static const Command commands[] = {
+    { "generate", random_jdm_main,  "genera la JDM di un grafo casuale (come random_jdm)" },
+    { "build",    ibrido_main,      "costruisce un grafo da una JDM (come ibrido)" },
+    { "verify",   compare_jdm_main, "confronta la JDM di un grafo con un .nkk (come compare_jdm)" },
+    { "mutate",   jdm_mutate_main,  "applica scambi casuali a una JDM (come jdm_mutate)" },
+    { "pipeline", pipeline_main,    "generate -> build -> verify in memoria" },
+};
+
+static void usage(const char *prog) {
+    fprintf(stderr, "Uso: %s <comando> [argomenti]\n\nComandi:\n", prog);
+    for (size_t i = 0; i < sizeof(commands) / sizeof(commands[0]); i++)
+        fprintf(stderr, "  %-9s %s\n", commands[i].name, commands[i].help);
+    fprintf(stderr,
+            "\n%s pipeline [-j out.nkk] [-o out.graph] [-t stat.csv] [-b ordine] [-e motore] [-f formato]\n"
+            "             [-p secondi] [-P file]\n"
+            "             [--] [opzioni di generate] <n> [p]\n"
+            "  -j file   scrive anche la JDM generata\n"
+            "  -o file   scrive anche il grafo costruito (edge list)\n"
+            "  -t file   statistiche del grafo costruito dalla sua JDM (come compare_jdm -t)\n"
+            "  -b ordine ordine dei blocchi in costruzione (come ibrido -o)\n"
+            "  -e motore motore di costruzione: sampling o bucket (come ibrido -e)\n"
+            "  -f formato formato del grafo scritto con -o: text, delta, zstd o csr (come ibrido -f)\n"
+            "  -p, -P    avanzamento della costruzione (come ibrido -p / -P)\n"
+            "  le opzioni di generate vanno dopo \"--\"\n",
+            prog);
+}
+
+static double elapsed(const struct timeval *a, const struct timeval *b) {
+    return ((b->tv_sec - a->tv_sec) * 1000000 + (b->tv_usec - a->tv_usec)) / 1e6;
+}
+
+/* ---- pipeline ----
+   1. Genera il grafo casuale e ne calcola la JDM (random_jdm).
+   2. Valida la JDM e costruisce un grafo che la realizza (ibrido).
+   3. Ricalcola la JDM del grafo costruito e la confronta (compare_jdm).
+   I file vengono scritti solo se richiesti con -j / -o.
+   Restituisce 0 se la JDM del grafo costruito coincide con quella generata.
+*/
+static int pipeline_main(int argc, char *argv[]) {
+    char *jdm_out = NULL, *graph_out = NULL, *stats_out = NULL;
+    BuildOptions bopt = { ORDER_HASH, ENGINE_SAMPLING, NULL };
+    GraphFormat format = GRAPH_TEXT;
+    double progress_interval = 0;
+    char *status_path = NULL;
+    int opt;
+    while ((opt = getopt(argc, argv, "+j:o:t:b:e:f:p:P:h")) != -1) {
+        switch (opt) {
+        case 'p': progress_interval = atof(optarg); break;
+        case 'P': status_path = optarg; break;
+        case 'j': jdm_out = optarg; break;
+        case 'o': graph_out = optarg; break;
+        case 't': stats_out = optarg; break;
+        case 'b':
+            if (parse_block_order(optarg, &bopt.order) != 0) {
+                usage("jdm");
+                return 1;
+            }
+            break;
+        case 'e':
+            if (parse_build_engine(optarg, &bopt.engine) != 0) {
+                usage("jdm");
+                return 1;
+            }
+            break;
+        case 'f':
+            if (parse_graph_format(optarg, &format) != 0) {
+                usage("jdm");
+                return 1;
+            }
+            break;
+        default:  usage("jdm"); return 1;
+        }
+    }
+    /* Gli argomenti rimanenti sono quelli di generate: argv[0] resta il nome del comando */
+    char **gen_argv = argv + optind - 1;
+    int gen_argc = argc - optind + 1;
+    gen_argv[0] = argv[0];
+    /* optind = 0 e non 1: solo così glibc azzera tutto lo stato di getopt,
+       compresa la modalità "+" del ciclo qui sopra */
+    optind = 0;
+    GenParams gp;
+    if (gen_parse_args(gen_argc, gen_argv, &gp) != 0)
+        return 1;
+
+    struct timeval t0, t1, t2, t3;
+
+    /* 1) Generazione */
+    gettimeofday(&t0, NULL);
+    igraph_t g;
+    generate_graph(&gp, &g);
+    GHashTable *nkk = compute_jdm_from_igraph(&g);
+    igraph_destroy(&g);
+    if (jdm_out) {
+        FILE *fp = fopen(jdm_out, "w");
+        if (!fp) {
+            perror(jdm_out);
+            jdm_table_destroy(nkk);
+            return 1;
+        }
+        int werr = write_jdm(fp, nkk);
+        if (fclose(fp) != 0 || werr) {
+            fprintf(stderr, "Errore: scrittura di %s non riuscita\n", jdm_out);
+            jdm_table_destroy(nkk);
+            return 1;
+        }
+    }
+    gettimeofday(&t1, NULL);
+
+    /* 2) Costruzione */
+    JdmInput in;
+    if (jdm_input_from_table(nkk, &in) != 0) {
+        jdm_input_destroy(&in);
+        return 1;
+    }
+    igraph_vector_int_t edge_list;
+    igraph_vector_int_init(&edge_list, 0);
+    FastGraph fast_g = { 0 };
+    BuildProgress progress;
+    ProgressReporter *reporter = NULL;
+    if (progress_interval > 0 || status_path) {
+        bopt.progress = &progress;
+        reporter = progress_start(&progress, progress_interval > 0 ? progress_interval : 10, status_path);
+    }
+    int build_err = joint_degree_model(&in, &bopt, &fast_g, &edge_list);
+    progress_stop(reporter);
+    if (build_err) {
+        fprintf(stderr, "Errore: costruzione non riuscita.\n");
+        igraph_vector_int_destroy(&edge_list);
+        fastgraph_destroy(&fast_g);
+        jdm_input_destroy(&in);
+        return 1;
+    }
+    int write_err = graph_out ? write_graph(graph_out, &fast_g, format) : 0;
+    gettimeofday(&t2, NULL);
+
+    /* 3) Verifica */
+    igraph_t built;
+    fastgraph_to_igraph(&fast_g, &built);
+    GHashTable *nkk_out = compute_jdm_from_igraph(&built);
+    int diff = compare_jdms(in.nkk, nkk_out);
+    int err = stats_out ? write_jdm_stats(stats_out, nkk_out, (long) igraph_vcount(&built)) : 0;
+    gettimeofday(&t3, NULL);
+
+    if (diff == 0)
+        printf("[OK] la JDM calcolata corrisponde a quello di input.\n");
+    else
+        printf("[ATTENZIONE] Trovate %d differenze tra la JDM di input e quella calcolata.\n", diff);
+    printf("Tempo generazione:%.3f secondi\n", elapsed(&t0, &t1));
+    printf("Tempo costruzione:%.3f secondi\n", elapsed(&t1, &t2));
+    printf("Tempo verifica:%.3f secondi\n", elapsed(&t2, &t3));
+
+    jdm_table_destroy(nkk_out);
+    igraph_destroy(&built);
+    igraph_vector_int_destroy(&edge_list);
+    fastgraph_destroy(&fast_g);
+    jdm_input_destroy(&in);
+    return diff == 0 && !err && !write_err ? 0 : 1;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        usage(argv[0]);
+        return 1;
+    }
+    for (size_t i = 0; i < sizeof(commands) / sizeof(commands[0]); i++) {
+        if (strcmp(argv[1], commands[i].name) == 0)
+            return commands[i].run(argc - 1, argv + 1);
+    }
+    usage(argv[0]);
+    return 1;
+}
@@ -0,0 +1,164 @@
+#ifndef JDM_H
+#define JDM_H
+
+#include <stdio.h>
+#include <glib.h>
+#include <igraph.h>
+#include "jdm_index.h"
+
+/* ===============================
+   libjdm: interfaccia comune degli strumenti
+   =============================== */
+
+/* Ogni sorgente (random_jdm.c, ibrido.c, compare_jdm.c, jdm_mutate.c) resta un
+   programma a sé. Compilato con -DJDM_LIBRARY perde il proprio main ed entra in
+   libjdm.a, da cui il driver jdm richiama sia i singoli comandi (<nome>_main)
+   sia le funzioni qui sotto per la pipeline in memoria.
+   Una JDM in memoria è una GHashTable<k, GHashTable<l, valore>> simmetrica,
+   con la diagonale che conta due volte ogni arco (come nei file .nkk); chiavi
+   e valori passano per JDM_TO_POINTER / JDM_FROM_POINTER (jdm_index.h).
+*/
+
+/* ---- random_jdm.c ---- */
+
+/* Modelli di generazione disponibili. */
+typedef enum {
+    MODEL_ER,   // Erdős–Rényi G(n,p)
+    MODEL_CL,   // Chung–Lu con pesi power-law
+    MODEL_CM,   // configuration model (cancellato) con gradi power-law
+    MODEL_BA    // Barabási–Albert con attrattività iniziale
+} GenModel;
+
+/* Parametri della generazione, come da riga di comando di random_jdm. */
+typedef struct {
+    GenModel model;
+    int n;
+    double p, avg_k, gamma, kmax, assort;
+    int rounds;
+    unsigned long seed;
+} GenParams;
+
+int gen_parse_args(int argc, char *argv[], GenParams *gp);
+void generate_graph(const GenParams *gp, igraph_t *g);
+int write_jdm(FILE *fp, GHashTable *nkk);
+int random_jdm_main(int argc, char *argv[]);
+
+/* ---- ibrido.c ---- */
+
+/* FastGraph: struttura per il grafo costruito velocemente, con adiacenza ibrida per nodo.
+   - total_nodes: numero di nodi (0..total_nodes-1)
+   - adj: pool unico degli slot di adiacenza; il nodo u usa adj[adj_off[u] .. adj_off[u+1]-1],
+         dimensionati sul suo grado obiettivo: array ordinato per i nodi di grado basso,
+         tabella hash a indirizzamento aperto per gli hub (vedi ibrido.c).
+   - adj_len: grado corrente di ogni nodo.
+   - node_residual: array di lunghezza total_nodes che tiene traccia degli stub liberi per ogni nodo
+         (usato solo durante la costruzione).
+   - node_cap, adj_cap: nodi e slot allocati, riusati da fastgraph_init finché bastano.
+   Un FastGraph va azzerato ({ 0 }) prima del primo fastgraph_init.
+*/
+typedef struct {
+    jdm_node_t total_nodes;
+    jdm_node_t *adj;
+    size_t *adj_off;
+    int *adj_len;
+    int *node_residual;
+    jdm_node_t node_cap;
+    size_t adj_cap;
+} FastGraph;
+
+/* JdmInput: JDM validata insieme ai dati derivati.
+   - nkk: GHashTable<k, GHashTable<l, valore>>, simmetrica.
+   - nk: GHashTable<k, numero di nodi di grado k>.
+   - total_nodes: somma di nk.
+   - total_edges: archi del grafo (la diagonale nkk[k][k] conta due volte ogni arco).
+*/
+typedef struct {
+    GHashTable *nkk;
+    GHashTable *nk;
+    jdm_node_t total_nodes;
+    jdm_edge_t total_edges;
+} JdmInput;
+
+/* Ordine di riempimento dei blocchi (k,l) in joint_degree_model. */
+typedef enum {
+    ORDER_HASH,       // ordine di iterazione delle tabelle
+    ORDER_DEGREE,     // grado massimo decrescente (prima gli hub)
+    ORDER_DENSITY,    // prima i blocchi più pieni rispetto alle coppie disponibili
+    ORDER_ASCENDING   // grado crescente
+} BlockOrder;
+
+/* Motore di costruzione di joint_degree_model. */
+typedef enum {
+    ENGINE_SAMPLING,  // campionamento con rifiuto + neighbor_switch
+    ENGINE_BUCKET     // quote bilanciate per blocco, esatto in O(m)
+} BuildEngine;
+
+/* Formato del grafo scritto da write_graph (vedi jdm_edges.h e jdm_csr.h). */
+typedef enum {
+    GRAPH_TEXT,        // righe "u,v"
+    GRAPH_DELTA,       // delta + varint a blocchi
+    GRAPH_DELTA_ZSTD,  // come GRAPH_DELTA, blocchi compressi con zstd (ZSTD=1)
+    GRAPH_CSR          // adiacenza CSR da mappare in memoria (jdm_csr.h)
+} GraphFormat;
+
+/* Avanzamento della costruzione: joint_degree_model lo aggiorna con store
+   relaxed (un solo scrittore), un thread di progress_start lo legge.
+   block_cell è la cella (k,l) corrente come (k << 32) | l, in un'unica parola
+   perché il lettore non veda k e l di blocchi diversi.
+*/
+typedef struct {
+    long edges_total;
+    long edges;
+    long attempts;     // coppie estratte dal motore sampling
+    long switches;
+    long block_cell;
+    int block, n_blocks;
+} BuildProgress;
+
+/* Opzioni della costruzione. progress (opzionale) riceve l'avanzamento. */
+typedef struct {
+    BlockOrder order;
+    BuildEngine engine;
+    BuildProgress *progress;
+} BuildOptions;
+
+/* Thread che riporta l'avanzamento ogni interval secondi su stderr o, se
+   status_path non è NULL, riscrivendo quel file. */
+typedef struct ProgressReporter ProgressReporter;
+
+int load_nkk(char *fname, JdmInput *in);
+int load_nkk_stream(FILE *fp, const char *src, JdmInput *in);
+int jdm_input_from_table(GHashTable *nkk, JdmInput *in);
+void jdm_input_destroy(JdmInput *in);
+int is_valid_joint_degree(const JdmInput *in);
+int fastgraph_init(FastGraph *g, jdm_node_t n, const int *degree);
+void fastgraph_destroy(FastGraph *g);
+int parse_block_order(const char *name, BlockOrder *order);
+int parse_build_engine(const char *name, BuildEngine *engine);
+const char *block_order_name(BlockOrder order);
+ProgressReporter *progress_start(BuildProgress *p, double interval, const char *status_path);
+void progress_stop(ProgressReporter *r);
+int joint_degree_model(const JdmInput *in, const BuildOptions *opt, FastGraph *g,
+                       igraph_vector_int_t *edge_list);
+void convert_to_igraph(const FastGraph *g, igraph_t *igraph_graph, const igraph_vector_int_t *edge_list);
+void fastgraph_to_igraph(const FastGraph *g, igraph_t *igraph_graph);
+int parse_graph_format(const char *name, GraphFormat *format);
+int write_graph(char *fname, const FastGraph *g, GraphFormat format);
+long write_graph_stream(FILE *fp, const FastGraph *g, int n_threads);
+int ibrido_main(int argc, char *argv[]);
+
+/* ---- compare_jdm.c ---- */
+
+GHashTable *compute_jdm_from_igraph(const igraph_t *g);
+int compare_jdms(GHashTable *nkk_in, GHashTable *nkk_out);
+int write_jdm_stats(const char *path, GHashTable *nkk, long n_nodes);
+void build_igraph_from_edgelist(const char *filename, igraph_t *g);
+void jdm_table_destroy(GHashTable *nkk);
+int compare_jdm_main(int argc, char *argv[]);
+
+/* ---- jdm_mutate.c ---- */
+
+/* jdm_mutate.c non dipende da glib/igraph e non include questo header. */
+int jdm_mutate_main(int argc, char *argv[]);
+
+#endif /* JDM_H */
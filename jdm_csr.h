@@ -0,0 +1,192 @@
+#ifndef JDM_CSR_H
+#define JDM_CSR_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "jdm_index.h"
+
+/* ===============================
+   Grafo CSR su disco (mappabile)
+   =============================== */
+
+/* Il grafo finale come adiacenza compressa, da usare con mmap senza parse né sort:
+   - intestazione di 32 byte: "JDMC", uint32 CSR_BYTE_ORDER, uint32 flag,
+     uint32 riservato (0), uint64 numero di nodi n, uint64 numero di estremi
+     (2 volte gli archi);
+   - n + 1 offset uint64: i vicini di u sono adj[off[u] .. off[u+1]-1];
+   - gli estremi, jdm_node_t, crescenti per ogni nodo.
+   Ogni arco compare in entrambe le direzioni, senza loop né duplicati.
+   I numeri sono nell'ordine dei byte di chi scrive (CSR_BYTE_ORDER lo rivela) e
+   gli estremi hanno la larghezza della versione che ha scritto il file
+   (CSR_FLAG_ID64 nella versione INDEX64): il lettore rifiuta i file che non
+   può usare così come sono. Offset ed estremi partono da posizioni multiple di 8.
+*/
+#define CSR_MAGIC "JDMC"
+#define CSR_BYTE_ORDER 0x01020304u
+#define CSR_FLAG_ID64 1u
+#define CSR_HEADER_BYTES 32
+
+#if JDM_INDEX64
+#define CSR_FLAGS CSR_FLAG_ID64
+#else
+#define CSR_FLAGS 0u
+#endif
+
+/* Un CSR mappato: in sola lettura da csr_map, scrivibile da csr_create. */
+typedef struct {
+    jdm_node_t n_nodes;
+    uint64_t n_arcs;      // estremi: 2 volte gli archi
+    uint64_t *off;        // n_nodes + 1
+    jdm_node_t *adj;      // n_arcs
+    void *map;
+    size_t map_len;
+} CsrGraph;
+
+static inline int csr_degree(const CsrGraph *g, jdm_node_t u) {
+    return (int) (g->off[u + 1] - g->off[u]);
+}
+
+/* Dimensione del file per n nodi e n_arcs estremi; 0 se non sta in size_t. */
+static inline size_t csr_file_size(uint64_t n, uint64_t n_arcs) {
+    uint64_t len = CSR_HEADER_BYTES + 8 * (n + 1);
+    if (n_arcs > (UINT64_MAX - len) / sizeof(jdm_node_t)) return 0;
+    len += n_arcs * sizeof(jdm_node_t);
+    return len > SIZE_MAX ? 0 : (size_t) len;
+}
+
+/* Collega off e adj di g alla mappatura map di n nodi. */
+static inline void csr_bind(CsrGraph *g, void *map, size_t len, jdm_node_t n, uint64_t n_arcs) {
+    g->map = map;
+    g->map_len = len;
+    g->n_nodes = n;
+    g->n_arcs = n_arcs;
+    g->off = (uint64_t *) ((char *) map + CSR_HEADER_BYTES);
+    g->adj = (jdm_node_t *) (g->off + (size_t) n + 1);
+}
+
+/* Vero se il file path inizia con CSR_MAGIC. */
+static inline int csr_file_is_csr(const char *path) {
+    char magic[4];
+    FILE *fp = fopen(path, "rb");
+    if (!fp) return 0;
+    int is_csr = fread(magic, 1, 4, fp) == 4 && memcmp(magic, CSR_MAGIC, 4) == 0;
+    fclose(fp);
+    return is_csr;
+}
+
+/* csr_create:
+   Crea path con lo spazio per n nodi e n_arcs estremi, scrive l'intestazione e
+   lo mappa in scrittura in g: il chiamante riempie g->off e g->adj e chiude con
+   csr_unmap. Lo spazio è riservato subito con posix_fallocate: un disco pieno
+   è un errore qui e non un SIGBUS durante il riempimento.
+   Restituisce 0 se il file è pronto.
+*/
+static inline int csr_create(const char *path, jdm_node_t n, uint64_t n_arcs, CsrGraph *g) {
+    memset(g, 0, sizeof(*g));
+    size_t len = csr_file_size((uint64_t) n, n_arcs);
+    if (len == 0) {
+        fprintf(stderr, "%s: CSR troppo grande (%" PRI_NODE " nodi)\n", path, n);
+        return 1;
+    }
+    int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0666);
+    if (fd < 0) {
+        perror(path);
+        return 1;
+    }
+    int err = posix_fallocate(fd, 0, (off_t) len);
+    if (err != 0) {
+        fprintf(stderr, "%s: %s\n", path, strerror(err));
+        close(fd);
+        return 1;
+    }
+    void *map = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        perror(path);
+        return 1;
+    }
+    uint8_t *h = map;
+    uint32_t order = CSR_BYTE_ORDER, flags = CSR_FLAGS, reserved = 0;
+    uint64_t n64 = (uint64_t) n;
+    memcpy(h, CSR_MAGIC, 4);
+    memcpy(h + 4, &order, 4);
+    memcpy(h + 8, &flags, 4);
+    memcpy(h + 12, &reserved, 4);
+    memcpy(h + 16, &n64, 8);
+    memcpy(h + 24, &n_arcs, 8);
+    csr_bind(g, map, len, n, n_arcs);
+    return 0;
+}
+
+/* csr_map:
+   Mappa in sola lettura il CSR in path. Controlla intestazione, dimensione e
+   offset (crescenti, da 0 a n_arcs: O(n)); gli estremi non vengono letti, quindi
+   chi li usa come indici verifica che siano < n_nodes.
+   Restituisce 0 se il file è utilizzabile.
+*/
+static inline int csr_map(const char *path, CsrGraph *g) {
+    memset(g, 0, sizeof(*g));
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        perror(path);
+        return 1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < CSR_HEADER_BYTES || (uint64_t) st.st_size > SIZE_MAX) {
+        fprintf(stderr, "%s: CSR troncato o non leggibile\n", path);
+        close(fd);
+        return 1;
+    }
+    size_t len = (size_t) st.st_size;
+    void *map = mmap(NULL, len, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        perror(path);
+        return 1;
+    }
+    const uint8_t *h = map;
+    uint32_t order, flags;
+    uint64_t n, n_arcs;
+    memcpy(&order, h + 4, 4);
+    memcpy(&flags, h + 8, 4);
+    memcpy(&n, h + 16, 8);
+    memcpy(&n_arcs, h + 24, 8);
+    const char *why = NULL;
+    if (memcmp(h, CSR_MAGIC, 4) != 0 || order != CSR_BYTE_ORDER)
+        why = "intestazione non valida o ordine dei byte diverso";
+    else if ((flags & CSR_FLAG_ID64) != CSR_FLAGS)
+        why = (flags & CSR_FLAG_ID64) ? "id a 64 bit, ricompilare con INDEX64=1"
+                                      : "id a 32 bit, scritto dalla versione compatta";
+    else if (n >= (uint64_t) JDM_NODE_MAX)
+        why = "troppi nodi";
+    else if (csr_file_size(n, n_arcs) != len)
+        why = "dimensione del file non coerente con l'intestazione";
+    if (!why) {
+        csr_bind(g, map, len, (jdm_node_t) n, n_arcs);
+        int bad = g->off[0] != 0 || g->off[n] != n_arcs;
+        for (uint64_t u = 0; !bad && u < n; u++)
+            bad = g->off[u + 1] < g->off[u] || g->off[u + 1] - g->off[u] > JDM_DEGREE_MAX;
+        if (bad) why = "offset non validi";
+    }
+    if (why) {
+        fprintf(stderr, "%s: CSR non utilizzabile: %s\n", path, why);
+        munmap(map, len);
+        memset(g, 0, sizeof(*g));
+        return 1;
+    }
+    return 0;
+}
+
+/* Chiude la mappatura di g (le scritture di csr_create restano nel file). */
+static inline void csr_unmap(CsrGraph *g) {
+    if (g->map) munmap(g->map, g->map_len);
+    memset(g, 0, sizeof(*g));
+}
+
+#endif /* JDM_CSR_H */
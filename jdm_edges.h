@@ -0,0 +1,399 @@
+#ifndef JDM_EDGES_H
+#define JDM_EDGES_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "jdm_index.h"
+#if JDM_ZSTD
+#include <zstd.h>
+#endif
+
+/* ===============================
+   Edge list compressa (delta + varint)
+   =============================== */
+
+/* Alternativa binaria all'edge list testuale "u,v" (circa 14 byte per arco):
+   - intestazione: "JDMG", uint32 flag, uint64 numero di nodi;
+   - blocchi indipendenti, ognuno preceduto da 5 uint32: primo nodo, numero di
+     nodi, numero di archi, byte decodificati, byte memorizzati.
+   Contenuto decodificato di un blocco: per ogni nodo u, in ordine, il numero di
+   vicini v > u e poi quei vicini crescenti come differenze (la prima rispetto a u),
+   tutti in varint (7 bit per byte, fino a 64 bit). Le differenze sono >= 1, quindi
+   il formato non rappresenta loop né archi duplicati. Il primo nodo di un blocco
+   è a 32 bit: il formato arriva a 2^32 nodi anche nella versione INDEX64.
+   Con EDGES_FLAG_ZSTD (solo se compilato con -DJDM_ZSTD=1) il contenuto di ogni
+   blocco è compresso con zstd. I numeri dell'intestazione sono little endian.
+   Il lettore individua i blocchi dalle intestazioni e li decodifica in parallelo,
+   ognuno direttamente nella propria porzione dell'array di archi.
+*/
+#define EDGES_MAGIC "JDMG"
+#define EDGES_FLAG_ZSTD 1u
+#define EDGES_BLOCK_BYTES (1 << 20)   /* contenuto decodificato per blocco, circa */
+#define EDGES_ZSTD_LEVEL 3
+
+static inline void edges_put_le32(uint8_t *p, uint32_t v) {
+    p[0] = (uint8_t) v;
+    p[1] = (uint8_t) (v >> 8);
+    p[2] = (uint8_t) (v >> 16);
+    p[3] = (uint8_t) (v >> 24);
+}
+
+static inline uint32_t edges_get_le32(const uint8_t *p) {
+    return (uint32_t) p[0] | (uint32_t) p[1] << 8 | (uint32_t) p[2] << 16 | (uint32_t) p[3] << 24;
+}
+
+/* Scrive v in varint da p; restituisce il puntatore al byte successivo
+   (al massimo EDGES_VARINT_MAX byte). */
+#define EDGES_VARINT_MAX 10
+
+static inline uint8_t *edges_put_varint(uint8_t *p, uint64_t v) {
+    while (v >= 0x80) {
+        *p++ = (uint8_t) (v | 0x80);
+        v >>= 7;
+    }
+    *p++ = (uint8_t) v;
+    return p;
+}
+
+/* Legge un varint da *p senza superare end; restituisce 0 se è troncato o troppo lungo. */
+static inline int edges_get_varint(const uint8_t **p, const uint8_t *end, uint64_t *v) {
+    uint64_t x = 0;
+    for (int shift = 0; shift < 7 * EDGES_VARINT_MAX && *p < end; shift += 7) {
+        uint8_t b = *(*p)++;
+        x |= (uint64_t) (b & 0x7f) << shift;
+        if (!(b & 0x80)) {
+            *v = x;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/* ---- Scrittura ---- */
+
+/* EdgeWriter: accumula i nodi in un blocco e lo scrive (compresso se richiesto)
+   quando supera EDGES_BLOCK_BYTES. I nodi vanno aggiunti in ordine da 0.
+*/
+typedef struct {
+    FILE *fp;
+    uint32_t flags;
+    uint32_t first_node, n_nodes, n_edges;
+    uint8_t *raw;
+    size_t raw_len, raw_cap;
+    uint8_t *packed;
+    size_t packed_cap;
+    long total_edges;
+    int err;
+} EdgeWriter;
+
+static inline void edges_writer_flush(EdgeWriter *w) {
+    if (w->n_nodes == 0 || w->err) return;
+    const uint8_t *payload = w->raw;
+    size_t stored = w->raw_len;
+#if JDM_ZSTD
+    if (w->flags & EDGES_FLAG_ZSTD) {
+        size_t bound = ZSTD_compressBound(w->raw_len);
+        if (bound > w->packed_cap) {
+            free(w->packed);
+            w->packed = malloc(bound);
+            w->packed_cap = w->packed ? bound : 0;
+        }
+        stored = w->packed ? ZSTD_compress(w->packed, bound, w->raw, w->raw_len, EDGES_ZSTD_LEVEL) : 0;
+        if (!w->packed || ZSTD_isError(stored)) {
+            w->err = 1;
+            return;
+        }
+        payload = w->packed;
+    }
+#endif
+    uint8_t hdr[20];
+    edges_put_le32(hdr, w->first_node);
+    edges_put_le32(hdr + 4, w->n_nodes);
+    edges_put_le32(hdr + 8, w->n_edges);
+    edges_put_le32(hdr + 12, (uint32_t) w->raw_len);
+    edges_put_le32(hdr + 16, (uint32_t) stored);
+    if (fwrite(hdr, 1, sizeof(hdr), w->fp) != sizeof(hdr) || fwrite(payload, 1, stored, w->fp) != stored)
+        w->err = 1;
+    w->first_node += w->n_nodes;
+    w->n_nodes = w->n_edges = 0;
+    w->raw_len = 0;
+}
+
+/* Scrive l'intestazione del file; zstd chiede la compressione dei blocchi.
+   Restituisce 0, o 1 se zstd non è disponibile, i nodi superano 2^32 o la
+   scrittura fallisce. */
+static inline int edges_writer_open(EdgeWriter *w, FILE *fp, long n_nodes, int zstd) {
+    memset(w, 0, sizeof(*w));
+    w->fp = fp;
+    if ((uint64_t) n_nodes > UINT32_MAX) {
+        fprintf(stderr, "Edge list compressa: %ld nodi oltre il limite di 2^32\n", n_nodes);
+        return 1;
+    }
+#if JDM_ZSTD
+    w->flags = zstd ? EDGES_FLAG_ZSTD : 0;
+#else
+    if (zstd) return 1;
+#endif
+    w->raw_cap = EDGES_BLOCK_BYTES + 64;
+    w->raw = malloc(w->raw_cap);
+    if (!w->raw) return 1;
+    uint8_t hdr[16];
+    memcpy(hdr, EDGES_MAGIC, 4);
+    edges_put_le32(hdr + 4, w->flags);
+    edges_put_le32(hdr + 8, (uint32_t) ((uint64_t) n_nodes & 0xffffffffu));
+    edges_put_le32(hdr + 12, (uint32_t) ((uint64_t) n_nodes >> 32));
+    if (fwrite(hdr, 1, sizeof(hdr), fp) != sizeof(hdr)) w->err = 1;
+    return w->err;
+}
+
+/* Aggiunge il nodo u con i suoi vicini ordinati (neighbors[0..n-1], crescenti):
+   vengono scritti solo quelli maggiori di u. */
+static inline void edges_writer_node(EdgeWriter *w, jdm_node_t u, const jdm_node_t *neighbors, int n) {
+    if (w->err) return;
+    int i = 0;
+    while (i < n && neighbors[i] <= u) i++;
+    size_t need = (size_t) (n - i + 1) * EDGES_VARINT_MAX;
+    if (w->raw_len + need > UINT32_MAX) {
+        /* Un blocco (un solo nodo, al limite) non può superare i 32 bit della sua lunghezza */
+        w->err = 1;
+        return;
+    }
+    if (w->raw_len + need > w->raw_cap) {
+        size_t cap = w->raw_len + need;
+        uint8_t *raw = realloc(w->raw, cap);
+        if (!raw) {
+            w->err = 1;
+            return;
+        }
+        w->raw = raw;
+        w->raw_cap = cap;
+    }
+    uint8_t *p = edges_put_varint(w->raw + w->raw_len, (uint64_t) (n - i));
+    jdm_node_t prev = u;
+    for (; i < n; i++) {
+        p = edges_put_varint(p, (uint64_t) (neighbors[i] - prev));
+        prev = neighbors[i];
+        w->n_edges++;
+        w->total_edges++;
+    }
+    w->raw_len = (size_t) (p - w->raw);
+    w->n_nodes++;
+    if (w->raw_len >= EDGES_BLOCK_BYTES)
+        edges_writer_flush(w);
+}
+
+/* Scrive l'ultimo blocco e libera i buffer; restituisce 0 se tutto è stato scritto. */
+static inline int edges_writer_close(EdgeWriter *w) {
+    edges_writer_flush(w);
+    free(w->raw);
+    free(w->packed);
+    w->raw = w->packed = NULL;
+    return w->err;
+}
+
+/* ---- Lettura ---- */
+
+typedef struct {
+    const uint8_t *payload;
+    uint32_t first_node, n_nodes, n_edges, raw_len, stored_len;
+    long offset;  /* primo arco del blocco nell'array di uscita */
+} EdgeBlock;
+
+typedef struct {
+    EdgeBlock *blocks;
+    int n_blocks;
+    int next;
+    uint32_t flags;
+    uint64_t n_nodes;
+    jdm_node_t *edges;
+    int err;
+} EdgeDecodePool;
+
+/* Decodifica un blocco in edges[2*offset ..]; scratch (raw_len byte) serve solo con zstd. */
+static inline int edges_decode_block(const EdgeDecodePool *pool, const EdgeBlock *b, uint8_t *scratch) {
+    const uint8_t *p = b->payload;
+#if JDM_ZSTD
+    if (pool->flags & EDGES_FLAG_ZSTD) {
+        size_t got = ZSTD_decompress(scratch, b->raw_len, b->payload, b->stored_len);
+        if (ZSTD_isError(got) || got != b->raw_len) return 1;
+        p = scratch;
+    }
+#else
+    (void) scratch;
+#endif
+    const uint8_t *end = p + b->raw_len;
+    jdm_node_t *out = pool->edges + 2 * b->offset;
+    uint64_t left = b->n_edges;
+    for (uint32_t i = 0; i < b->n_nodes; i++) {
+        uint64_t u = (uint64_t) b->first_node + i;
+        uint64_t count, delta;
+        if (!edges_get_varint(&p, end, &count) || count > left) return 1;
+        left -= count;
+        uint64_t v = u;
+        for (uint64_t j = 0; j < count; j++) {
+            if (!edges_get_varint(&p, end, &delta) || delta == 0 || delta >= pool->n_nodes - v) return 1;
+            v += delta;
+            *out++ = (jdm_node_t) u;
+            *out++ = (jdm_node_t) v;
+        }
+    }
+    return p != end || left != 0;
+}
+
+static inline void *edges_decode_worker(void *arg) {
+    EdgeDecodePool *pool = arg;
+    uint8_t *scratch = NULL;
+    size_t scratch_cap = 0;
+    int c;
+    while ((c = __atomic_fetch_add(&pool->next, 1, __ATOMIC_RELAXED)) < pool->n_blocks) {
+        const EdgeBlock *b = &pool->blocks[c];
+        if ((pool->flags & EDGES_FLAG_ZSTD) && b->raw_len > scratch_cap) {
+            free(scratch);
+            scratch = malloc(b->raw_len);
+            scratch_cap = scratch ? b->raw_len : 0;
+        }
+        if (((pool->flags & EDGES_FLAG_ZSTD) && !scratch) || edges_decode_block(pool, b, scratch) != 0)
+            __atomic_store_n(&pool->err, 1, __ATOMIC_RELAXED);
+    }
+    free(scratch);
+    return NULL;
+}
+
+/* Vero se fp inizia con EDGES_MAGIC; non consuma l'input (basta un ungetc). */
+static inline int edges_is_compressed(FILE *fp) {
+    int c = getc(fp);
+    if (c != EOF) ungetc(c, fp);
+    return c == EDGES_MAGIC[0];
+}
+
+/* edges_read:
+   Legge da fp un'edge list compressa e la decodifica con n_threads thread.
+   In uscita *edges contiene 2 * *n_edges jdm_node_t (coppie u,v con u < v, da
+   liberare con free) e *n_nodes il numero di nodi, al più JDM_NODE_MAX. src identifica il file nei
+   messaggi. Restituisce 0 se il file è valido.
+*/
+static inline int edges_read(FILE *fp, const char *src, int n_threads,
+                             jdm_node_t **edges, long *n_edges, long *n_nodes) {
+    *edges = NULL;
+    *n_edges = *n_nodes = 0;
+    /* Il file compresso è piccolo: si legge tutto e si decodifica sul posto */
+    size_t len = 0, cap = 1 << 20;
+    uint8_t *data = malloc(cap);
+    size_t got;
+    while (data && (got = fread(data + len, 1, cap - len, fp)) > 0) {
+        len += got;
+        if (len == cap) {
+            uint8_t *bigger = realloc(data, cap * 2);
+            if (!bigger) {
+                free(data);
+                data = NULL;
+                break;
+            }
+            data = bigger;
+            cap *= 2;
+        }
+    }
+    if (!data) {
+        fprintf(stderr, "%s: memoria esaurita leggendo l'edge list compressa\n", src);
+        return 1;
+    }
+    EdgeDecodePool pool;
+    memset(&pool, 0, sizeof(pool));
+    if (len < 16 || memcmp(data, EDGES_MAGIC, 4) != 0) {
+        fprintf(stderr, "%s: intestazione dell'edge list compressa non valida\n", src);
+        free(data);
+        return 1;
+    }
+    pool.flags = edges_get_le32(data + 4);
+    pool.n_nodes = edges_get_le32(data + 8) | (uint64_t) edges_get_le32(data + 12) << 32;
+#if !JDM_ZSTD
+    if (pool.flags & EDGES_FLAG_ZSTD) {
+        fprintf(stderr, "%s: blocchi zstd, ricompilare con ZSTD=1 per leggerli\n", src);
+        free(data);
+        return 1;
+    }
+#endif
+    if (pool.n_nodes > (uint64_t) JDM_NODE_MAX) {
+        fprintf(stderr, "%s: troppi nodi (%llu)\n", src, (unsigned long long) pool.n_nodes);
+        free(data);
+        return 1;
+    }
+
+    /* Indice dei blocchi: la posizione di ogni blocco nell'array di archi */
+    int block_cap = 64;
+    pool.blocks = malloc(block_cap * sizeof(EdgeBlock));
+    long total = 0;
+    uint64_t next_node = 0;
+    size_t pos = 16;
+    int bad = !pool.blocks;
+    while (!bad && pos < len) {
+        if (len - pos < 20) {
+            bad = 1;
+            break;
+        }
+        EdgeBlock b;
+        b.first_node = edges_get_le32(data + pos);
+        b.n_nodes = edges_get_le32(data + pos + 4);
+        b.n_edges = edges_get_le32(data + pos + 8);
+        b.raw_len = edges_get_le32(data + pos + 12);
+        b.stored_len = edges_get_le32(data + pos + 16);
+        b.payload = data + pos + 20;
+        b.offset = total;
+        pos += 20;
+        if (b.first_node != next_node || len - pos < b.stored_len
+            || (!(pool.flags & EDGES_FLAG_ZSTD) && b.stored_len != b.raw_len)) {
+            bad = 1;
+            break;
+        }
+        pos += b.stored_len;
+        next_node += b.n_nodes;
+        total += b.n_edges;
+        if (pool.n_blocks == block_cap) {
+            EdgeBlock *more = realloc(pool.blocks, 2 * block_cap * sizeof(EdgeBlock));
+            if (!more) {
+                bad = 1;
+                break;
+            }
+            pool.blocks = more;
+            block_cap *= 2;
+        }
+        pool.blocks[pool.n_blocks++] = b;
+    }
+    if (!bad && next_node > pool.n_nodes) bad = 1;
+    if (!bad) {
+        pool.edges = malloc((2 * total + 1) * sizeof(jdm_node_t));
+        bad = !pool.edges;
+    }
+    if (!bad) {
+        /* Il thread chiamante decodifica insieme agli altri n_threads - 1
+           (e da solo se i thread non partono) */
+        if (n_threads > pool.n_blocks) n_threads = pool.n_blocks;
+        int extra = n_threads > 1 ? n_threads - 1 : 0;
+        pthread_t *threads = extra ? malloc(extra * sizeof(pthread_t)) : NULL;
+        int started = 0;
+        while (threads && started < extra
+               && pthread_create(&threads[started], NULL, edges_decode_worker, &pool) == 0)
+            started++;
+        edges_decode_worker(&pool);
+        for (int t = 0; t < started; t++)
+            pthread_join(threads[t], NULL);
+        free(threads);
+        bad = pool.err;
+    }
+    free(pool.blocks);
+    free(data);
+    if (bad) {
+        fprintf(stderr, "%s: edge list compressa danneggiata\n", src);
+        free(pool.edges);
+        return 1;
+    }
+    *edges = pool.edges;
+    *n_edges = total;
+    *n_nodes = (long) pool.n_nodes;
+    return 0;
+}
+
+#endif /* JDM_EDGES_H */
@@ -0,0 +1,62 @@
+#ifndef JDM_INDEX_H
+#define JDM_INDEX_H
+
+#include <stdint.h>
+#include <inttypes.h>
+
+/* ===============================
+   Tipi degli indici
+   =============================== */
+
+/* La larghezza di id e conteggi si sceglie in compilazione, dalla stessa sorgente:
+   - versione compatta (predefinita): jdm_node_t e jdm_edge_t a 32 bit, 4 byte
+     per estremo di arco nell'adiacenza;
+   - versione larga (-DJDM_INDEX64=1, make INDEX64=1): entrambi a 64 bit, per i
+     grafi con più di 2^31 - 1 nodi o archi.
+   jdm_node_t conta e numera i nodi, jdm_edge_t archi e stub (i valori nkk).
+   I gradi restano int in entrambe le versioni (JDM_DEGREE_MAX): le celle (k,l)
+   sono impacchettate in 64 bit come (k << 32) | l.
+   I limiti sono controllati alla lettura di JDM e grafi: un input che non ci
+   sta viene rifiutato con un errore invece di traboccare in silenzio.
+*/
+#if JDM_INDEX64
+#if INTPTR_MAX < INT64_MAX
+#error "JDM_INDEX64 richiede puntatori a 64 bit"
+#endif
+typedef int64_t jdm_node_t;
+typedef int64_t jdm_edge_t;
+#define JDM_NODE_MAX INT64_MAX
+#define JDM_EDGE_MAX INT64_MAX
+#define PRI_NODE PRId64
+#define PRI_EDGE PRId64
+#else
+typedef int32_t jdm_node_t;
+typedef int32_t jdm_edge_t;
+#define JDM_NODE_MAX INT32_MAX
+#define JDM_EDGE_MAX INT32_MAX
+#define PRI_NODE PRId32
+#define PRI_EDGE PRId32
+#endif
+
+#define JDM_DEGREE_MAX INT32_MAX
+
+/* Chiavi e valori delle GHashTable: GINT_TO_POINTER tronca a 32 bit,
+   questi conservano tutta la larghezza del puntatore. */
+#define JDM_TO_POINTER(x) ((void *) (intptr_t) (x))
+#define JDM_FROM_POINTER(p) ((intptr_t) (p))
+
+/* *sum = a + b se il risultato non supera max; restituisce 1 (e lascia *sum) altrimenti. */
+static inline int jdm_add_checked(int64_t *sum, int64_t b, int64_t max) {
+    int64_t s;
+    if (__builtin_add_overflow(*sum, b, &s) || s > max) return 1;
+    *sum = s;
+    return 0;
+}
+
+/* a * b saturato a INT64_MAX (a, b >= 0): capacità dei blocchi senza trabocco. */
+static inline int64_t jdm_mul_sat(int64_t a, int64_t b) {
+    int64_t p;
+    return __builtin_mul_overflow(a, b, &p) ? INT64_MAX : p;
+}
+
+#endif /* JDM_INDEX_H */
@@ -0,0 +1,232 @@
+#ifndef JDM_IO_H
+#define JDM_IO_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+
+/* ===============================
+   Scrittura canonica delle JDM
+   =============================== */
+
+/* Convenzione canonica di un file .nkk:
+   - una riga "k,l,valore" per ogni cella non nulla;
+   - matrice simmetrica: per k != l compaiono sia (k,l) che (l,k) con lo stesso valore,
+     la diagonale (k,k) compare una sola volta;
+   - righe ordinate per k e poi per l.
+   Due JDM identiche producono quindi file identici byte per byte.
+*/
+typedef struct {
+    long k, l, value;
+} JdmRow;
+
+/* Ordine lessicografico su (k,l). */
+static inline int jdm_row_cmp(const void *a, const void *b) {
+    const JdmRow *x = a, *y = b;
+    if (x->k != y->k) return (x->k > y->k) - (x->k < y->k);
+    return (x->l > y->l) - (x->l < y->l);
+}
+
+/* ===============================
+   Scrittura parallela in ordine
+   =============================== */
+
+/* Il testo (righe "k,l,valore" o "u,v") si formatta a blocchi di elementi
+   consecutivi: fino a n_threads thread formattano blocchi diversi, ognuno in un
+   proprio buffer, e il thread chiamante li scrive su fp nell'ordine dei blocchi.
+   I buffer sono 2 * n_threads, riusati a rotazione: un thread non prende il
+   blocco c finché il blocco c - 2 * n_threads non è stato scritto, quindi la memoria
+   resta limitata e fp può essere anche una pipe o stdout. L'uscita è identica
+   byte per byte a quella sequenziale.
+*/
+#define JDM_LONG_CHARS 21  /* caratteri di un long in decimale, segno compreso */
+
+/* Buffer di un blocco, che cresce con jdm_buf_reserve. */
+typedef struct {
+    char *data;
+    size_t len, cap;
+} JdmBuf;
+
+/* Spazio per altri extra byte; restituisce la posizione di scrittura (data + len) o NULL. */
+static inline char *jdm_buf_reserve(JdmBuf *b, size_t extra) {
+    if (b->len + extra > b->cap) {
+        size_t cap = b->cap ? b->cap : 1 << 16;
+        while (cap < b->len + extra) cap *= 2;
+        char *data = realloc(b->data, cap);
+        if (!data) return NULL;
+        b->data = data;
+        b->cap = cap;
+    }
+    return b->data + b->len;
+}
+
+/* Formatta gli elementi [first, last) accodandoli a out; 0 se riuscito. */
+typedef int (*JdmFormatFn)(void *ctx, size_t first, size_t last, JdmBuf *out);
+
+typedef struct {
+    FILE *fp;
+    size_t n_items, chunk_items, n_chunks;
+    JdmFormatFn format;
+    void *ctx;
+    int n_bufs;
+    JdmBuf *bufs;
+    size_t *buf_chunk;   /* blocco pronto in ogni buffer, SIZE_MAX se nessuno */
+    size_t next_chunk;   /* prossimo blocco da formattare */
+    size_t written;      /* blocchi già scritti */
+    int err;
+    pthread_mutex_t lock;
+    pthread_cond_t ready, free_buf;
+} JdmOrderedWriter;
+
+static inline void *jdm_format_worker(void *arg) {
+    JdmOrderedWriter *w = arg;
+    pthread_mutex_lock(&w->lock);
+    while (!w->err && w->next_chunk < w->n_chunks) {
+        size_t c = w->next_chunk++;
+        while (!w->err && c >= w->written + (size_t) w->n_bufs)
+            pthread_cond_wait(&w->free_buf, &w->lock);
+        if (w->err) break;
+        pthread_mutex_unlock(&w->lock);
+        JdmBuf *b = &w->bufs[c % w->n_bufs];
+        size_t first = c * w->chunk_items;
+        size_t last = first + w->chunk_items < w->n_items ? first + w->chunk_items : w->n_items;
+        b->len = 0;
+        int err = w->format(w->ctx, first, last, b);
+        pthread_mutex_lock(&w->lock);
+        if (err) {
+            w->err = 1;
+            pthread_cond_broadcast(&w->free_buf);
+        }
+        w->buf_chunk[c % w->n_bufs] = c;
+        pthread_cond_broadcast(&w->ready);
+    }
+    pthread_mutex_unlock(&w->lock);
+    return NULL;
+}
+
+/* jdm_write_ordered:
+   Scrive su fp gli n_items elementi formattati da format, a blocchi di
+   chunk_items, con fino a n_threads thread di formattazione (in linea se
+   n_threads <= 1 o c'è un solo blocco). Restituisce 0 se tutto è stato scritto.
+*/
+static inline int jdm_write_ordered(FILE *fp, size_t n_items, size_t chunk_items, JdmFormatFn format,
+                                    void *ctx, int n_threads) {
+    size_t n_chunks = (n_items + chunk_items - 1) / chunk_items;
+    if (n_threads > 1 && (size_t) n_threads > n_chunks) n_threads = (int) n_chunks;
+    if (n_threads <= 1) {
+        JdmBuf b = { NULL, 0, 0 };
+        int err = 0;
+        for (size_t first = 0; first < n_items && !err; first += chunk_items) {
+            b.len = 0;
+            err = format(ctx, first, first + chunk_items < n_items ? first + chunk_items : n_items, &b)
+                  || fwrite(b.data, 1, b.len, fp) != b.len;
+        }
+        free(b.data);
+        return err;
+    }
+    JdmOrderedWriter w = { fp, n_items, chunk_items, n_chunks, format, ctx, 2 * n_threads,
+                           NULL, NULL, 0, 0, 0, PTHREAD_MUTEX_INITIALIZER,
+                           PTHREAD_COND_INITIALIZER, PTHREAD_COND_INITIALIZER };
+    w.bufs = calloc(w.n_bufs, sizeof(JdmBuf));
+    w.buf_chunk = malloc(w.n_bufs * sizeof(size_t));
+    pthread_t *threads = malloc(n_threads * sizeof(pthread_t));
+    if (!w.bufs || !w.buf_chunk || !threads) {
+        free(w.bufs);
+        free(w.buf_chunk);
+        free(threads);
+        return jdm_write_ordered(fp, n_items, chunk_items, format, ctx, 1);
+    }
+    for (int i = 0; i < w.n_bufs; i++) w.buf_chunk[i] = SIZE_MAX;
+    int started = 0;
+    while (started < n_threads && pthread_create(&threads[started], NULL, jdm_format_worker, &w) == 0)
+        started++;
+    if (started == 0) {
+        /* Nessun thread: il chiamante formatta e scrive da solo */
+        free(w.bufs);
+        free(w.buf_chunk);
+        free(threads);
+        return jdm_write_ordered(fp, n_items, chunk_items, format, ctx, 1);
+    }
+    /* Scrittura nell'ordine dei blocchi, man mano che sono pronti */
+    for (size_t c = 0; c < n_chunks; c++) {
+        JdmBuf *b = &w.bufs[c % w.n_bufs];
+        pthread_mutex_lock(&w.lock);
+        while (!w.err && w.buf_chunk[c % w.n_bufs] != c)
+            pthread_cond_wait(&w.ready, &w.lock);
+        int err = w.err;
+        pthread_mutex_unlock(&w.lock);
+        if (err) break;
+        err = fwrite(b->data, 1, b->len, fp) != b->len;
+        pthread_mutex_lock(&w.lock);
+        w.buf_chunk[c % w.n_bufs] = SIZE_MAX;
+        w.written = c + 1;
+        if (err) w.err = 1;
+        pthread_cond_broadcast(&w.free_buf);
+        pthread_mutex_unlock(&w.lock);
+    }
+    for (int t = 0; t < started; t++)
+        pthread_join(threads[t], NULL);
+    for (int i = 0; i < w.n_bufs; i++)
+        free(w.bufs[i].data);
+    free(w.bufs);
+    free(w.buf_chunk);
+    free(threads);
+    pthread_mutex_destroy(&w.lock);
+    pthread_cond_destroy(&w.ready);
+    pthread_cond_destroy(&w.free_buf);
+    return w.err;
+}
+
+/* ---- righe JDM ---- */
+
+/* Scrive v in decimale a partire da p; restituisce il puntatore al carattere successivo. */
+static inline char *jdm_format_long(char *p, long v) {
+    char tmp[24];
+    int n = 0;
+    unsigned long u = v < 0 ? 0UL - (unsigned long) v : (unsigned long) v;
+    if (v < 0) *p++ = '-';
+    do {
+        tmp[n++] = (char) ('0' + u % 10);
+        u /= 10;
+    } while (u);
+    while (n > 0) *p++ = tmp[--n];
+    return p;
+}
+
+/* Accoda le righe "k,l,valore\n" di rows[first..last) (al massimo 3*21 caratteri + separatori ciascuna). */
+#define JDM_ROWS_PER_CHUNK (1 << 14)
+
+static inline int jdm_format_rows(void *ctx, size_t first, size_t last, JdmBuf *out) {
+    const JdmRow *rows = ctx;
+    char *p = jdm_buf_reserve(out, (last - first) * (3 * JDM_LONG_CHARS + 3));
+    if (!p) return 1;
+    for (size_t i = first; i < last; i++) {
+        p = jdm_format_long(p, rows[i].k);
+        *p++ = ',';
+        p = jdm_format_long(p, rows[i].l);
+        *p++ = ',';
+        p = jdm_format_long(p, rows[i].value);
+        *p++ = '\n';
+    }
+    out->len = (size_t) (p - out->data);
+    return 0;
+}
+
+/* Ordina rows per (k,l) e le scrive su fp, formattate in parallelo a blocchi da
+   n_threads thread (jdm_write_ordered): chi scrive da un thread già parallelo
+   passa 1. Il chiamante è responsabile di fornire entrambe le metà della
+   matrice simmetrica. Restituisce 0 se tutte le righe sono state scritte.
+*/
+static inline int jdm_write_rows(FILE *fp, JdmRow *rows, size_t n, int n_threads) {
+    qsort(rows, n, sizeof *rows, jdm_row_cmp);
+    if (jdm_write_ordered(fp, n, JDM_ROWS_PER_CHUNK, jdm_format_rows, rows, n_threads) != 0) {
+        fprintf(stderr, "Errore: scrittura della JDM non riuscita\n");
+        return 1;
+    }
+    return 0;
+}
+
+#endif /* JDM_IO_H */
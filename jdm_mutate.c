@@ -1,32 +1,422 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
 #include <time.h>
 #include <sys/time.h>
 #include <unistd.h>
+#include <string.h>
+#include <pthread.h>
+#include "jdm_io.h"
 
-typedef struct { int d1, d2; long count; } Entry;
+// Cella della JDM memorizzata una sola volta con d1 <= d2.
+// pos è la posizione della cella in cand[] (-1 se non candidata).
+typedef struct { int d1, d2; long count; long pos; } Cell;
 
-// Somma di riga r di J
-static long row_sum(long **J, int n, int r) {
-    long s = 0;
-    for (int c = 0; c < n; c++) s += J[r][c];
-    return s;
+// JDM sparsa con il numero di nodi per grado accanto alle celle.
+// Uno swap sposta k unità tra quattro celle senza cambiare alcuna somma
+// di riga, quindi nk[] resta valido per tutta l'esecuzione.
+// Memoria proporzionale alle celle non nulle (più nk[], lungo maxd+1).
+typedef struct {
+    int n;           // maxd + 1
+    long *nk;        // nk[d] = (somma riga d) / d, nk[0] = 0
+    Cell *cells;     // celle non nulle (jdm_remove toglie quelle azzerate dagli swap)
+    size_t ncells, cells_cap;
+    long *slots;     // hash ad indirizzamento aperto (d1,d2) -> indice in cells, -1 = vuoto
+    size_t nslots;   // potenza di 2
+    size_t *cand;    // indici delle celle off-diagonali con count >= 2
+    size_t ncand;
+} Jdm;
+
+static inline uint64_t cell_hash(int d1, int d2) {
+    uint64_t x = ((uint64_t)(uint32_t)d1 << 32) | (uint32_t)d2;
+    x ^= x >> 33; x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33; x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= x >> 33;
+    return x;
 }
 
-int main(int argc, char *argv[]) {
-    if (argc != 4) {
-        fprintf(stderr, "Usage: %s <input.nkk> <num_steps> <output.nkk>\n",
-                argv[0]);
+// Indice della cella (d1,d2) in cells, oppure -1
+static long jdm_find(const Jdm *J, int d1, int d2) {
+    if (d1 > d2) { int t = d1; d1 = d2; d2 = t; }
+    size_t mask = J->nslots - 1;
+    for (size_t h = cell_hash(d1, d2) & mask; J->slots[h] >= 0; h = (h + 1) & mask) {
+        const Cell *c = &J->cells[J->slots[h]];
+        if (c->d1 == d1 && c->d2 == d2) return J->slots[h];
+    }
+    return -1;
+}
+
+static void jdm_rehash(Jdm *J, size_t nslots) {
+    free(J->slots);
+    J->nslots = nslots;
+    J->slots = malloc(nslots * sizeof *J->slots);
+    if (!J->slots) { perror("malloc"); exit(EXIT_FAILURE); }
+    for (size_t i = 0; i < nslots; i++) J->slots[i] = -1;
+    for (size_t c = 0; c < J->ncells; c++) {
+        size_t h = cell_hash(J->cells[c].d1, J->cells[c].d2) & (nslots - 1);
+        while (J->slots[h] >= 0) h = (h + 1) & (nslots - 1);
+        J->slots[h] = (long)c;
+    }
+}
+
+// Indice della cella (d1,d2), creata a zero se assente
+static long jdm_get_or_add(Jdm *J, int d1, int d2) {
+    long c = jdm_find(J, d1, d2);
+    if (c >= 0) return c;
+    if (d1 > d2) { int t = d1; d1 = d2; d2 = t; }
+    if (J->ncells == J->cells_cap) {
+        J->cells_cap = J->cells_cap ? J->cells_cap * 2 : 64;
+        J->cells = realloc(J->cells, J->cells_cap * sizeof *J->cells);
+        J->cand  = realloc(J->cand,  J->cells_cap * sizeof *J->cand);
+        if (!J->cells || !J->cand) { perror("realloc"); exit(EXIT_FAILURE); }
+    }
+    c = (long)J->ncells++;
+    J->cells[c] = (Cell){d1, d2, 0, -1};
+    if (2 * J->ncells > J->nslots) {
+        jdm_rehash(J, J->nslots * 2);
+    } else {
+        size_t h = cell_hash(d1, d2) & (J->nslots - 1);
+        while (J->slots[h] >= 0) h = (h + 1) & (J->nslots - 1);
+        J->slots[h] = c;
+    }
+    return c;
+}
+
+// Slot di slots[] che punta alla cella c (presente)
+static size_t jdm_slot_of(const Jdm *J, long c) {
+    size_t mask = J->nslots - 1;
+    size_t h = cell_hash(J->cells[c].d1, J->cells[c].d2) & mask;
+    while (J->slots[h] != c) h = (h + 1) & mask;
+    return h;
+}
+
+// Toglie la cella c, che deve avere count == 0 (quindi non è candidata).
+// Nella hash lo slot si libera con backward shift (niente tombstone), in
+// cells[] l'ultima cella prende il posto di c: gli indici delle altre celle
+// restano validi, tranne quello dell'ultima, che diventa c.
+static void jdm_remove(Jdm *J, long c) {
+    size_t mask = J->nslots - 1;
+    size_t i = jdm_slot_of(J, c), j = i;
+    for (;;) {
+        j = (j + 1) & mask;
+        if (J->slots[j] < 0) break;
+        const Cell *m = &J->cells[J->slots[j]];
+        size_t home = cell_hash(m->d1, m->d2) & mask;
+        // m può scalare in i se la sua posizione naturale non cade in (i, j]
+        if (i <= j ? (home <= i || home > j) : (home <= i && home > j)) {
+            J->slots[i] = J->slots[j];
+            i = j;
+        }
+    }
+    J->slots[i] = -1;
+    long last = (long)--J->ncells;
+    if (c != last) {
+        J->slots[jdm_slot_of(J, last)] = c;
+        J->cells[c] = J->cells[last];
+        if (J->cells[c].pos >= 0) J->cand[J->cells[c].pos] = (size_t)c;
+    }
+}
+
+static inline long jdm_get(const Jdm *J, int d1, int d2) {
+    long c = jdm_find(J, d1, d2);
+    return c >= 0 ? J->cells[c].count : 0;
+}
+
+// Somma delta alla cella c e mantiene l'indice dei candidati
+// (celle off-diagonali con count >= 2) con push / swap-remove in O(1).
+static void jdm_add(Jdm *J, long c, long delta) {
+    Cell *cell = &J->cells[c];
+    long old = cell->count;
+    cell->count += delta;
+    if (cell->d1 == cell->d2) return;
+    if (old < 2 && cell->count >= 2) {
+        cell->pos = (long)J->ncand;
+        J->cand[J->ncand++] = (size_t)c;
+    } else if (old >= 2 && cell->count < 2) {
+        size_t last = J->cand[--J->ncand];
+        J->cand[cell->pos] = last;
+        J->cells[last].pos = cell->pos;
+        cell->pos = -1;
+    }
+}
+
+// Generatore splitmix64: uno stream indipendente per catena,
+// al posto di rand() che è condiviso tra i thread.
+typedef struct { uint64_t s; } Rng;
+
+static inline uint64_t rng_next(Rng *r) {
+    uint64_t z = (r->s += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+// Intero uniforme in [0, n)
+static inline long rng_below(Rng *r, long n) {
+    return (long)(rng_next(r) % (uint64_t)n);
+}
+
+// Copia profonda di src in dst (ogni catena muta la propria copia)
+static void jdm_copy(Jdm *dst, const Jdm *src) {
+    *dst = *src;
+    dst->nk    = malloc(src->n * sizeof *dst->nk);
+    dst->cells = malloc(src->cells_cap * sizeof *dst->cells);
+    dst->cand  = malloc(src->cells_cap * sizeof *dst->cand);
+    dst->slots = malloc(src->nslots * sizeof *dst->slots);
+    if (!dst->nk || !dst->cells || !dst->cand || !dst->slots) {
+        perror("malloc");
+        exit(EXIT_FAILURE);
+    }
+    memcpy(dst->nk,    src->nk,    src->n * sizeof *dst->nk);
+    memcpy(dst->cells, src->cells, src->ncells * sizeof *dst->cells);
+    memcpy(dst->cand,  src->cand,  src->ncand * sizeof *dst->cand);
+    memcpy(dst->slots, src->slots, src->nslots * sizeof *dst->slots);
+}
+
+static void jdm_free(Jdm *J) {
+    free(J->cells);
+    free(J->slots);
+    free(J->cand);
+    free(J->nk);
+}
+
+// Scrive J in forma canonica: tutte le celle non nulle,
+// simmetriche, ordinate per (k,l), formattate da n_threads thread
+static int jdm_write(const Jdm *J, const char *path, int n_threads) {
+    FILE *fout = fopen(path, "w");
+    if (!fout) { perror(path); return -1; }
+    JdmRow *out = malloc((2 * J->ncells + 1) * sizeof *out);
+    if (!out) { perror("malloc"); fclose(fout); return -1; }
+    size_t nout = 0;
+    for (size_t c = 0; c < J->ncells; c++) {
+        const Cell *cell = &J->cells[c];
+        if (cell->count == 0) continue;
+        out[nout++] = (JdmRow){cell->d1, cell->d2, cell->count};
+        if (cell->d1 != cell->d2)
+            out[nout++] = (JdmRow){cell->d2, cell->d1, cell->count};
+    }
+    int err = jdm_write_rows(fout, out, nout, n_threads);
+    free(out);
+    if (fclose(fout) != 0) err = 1;
+    return err ? -1 : 0;
+}
+
+// Nome del file di una catena: "out.nkk" -> "out.c3.nkk" (catena 3),
+// "out.c3.s1000.nkk" per lo snapshot al passo 1000. chain < 0 omette ".cN",
+// step < 0 omette ".sN".
+static char *chain_path(const char *outfile, int chain, long step) {
+    const char *slash = strrchr(outfile, '/');
+    const char *dot = strrchr(outfile, '.');
+    if (!dot || (slash && dot < slash)) dot = outfile + strlen(outfile);
+    size_t len = strlen(outfile) + 48;
+    char *path = malloc(len);
+    if (!path) { perror("malloc"); exit(EXIT_FAILURE); }
+    int n = snprintf(path, len, "%.*s", (int)(dot - outfile), outfile);
+    if (chain >= 0) n += snprintf(path + n, len - n, ".c%d", chain);
+    if (step >= 0)  n += snprintf(path + n, len - n, ".s%ld", step);
+    snprintf(path + n, len - n, "%s", dot);
+    return path;
+}
+
+// Massimo k trasferibile dallo swap tra le celle off-diagonali c1=(i1,j1)
+// e c2=(i2,j2) verso (i1,j2), (i2,j1); 0 se le celle non sono disjoint
+// o se manca capacità residua.
+static long swap_capacity(const Jdm *J, long c1, long c2) {
+    int i1 = J->cells[c1].d1, j1 = J->cells[c1].d2;
+    int i2 = J->cells[c2].d1, j2 = J->cells[c2].d2;
+    if (i2==i1 || i2==j1 || j2==i1 || j2==j1) return 0;
+    long x1 = J->cells[c1].count, x2 = J->cells[c2].count;
+    const long *nk = J->nk;
+
+    // capacità residue (i quattro gradi sono distinti)
+    long avail12 = nk[i1]*nk[j2] - jdm_get(J, i1, j2);
+    long avail21 = nk[i2]*nk[j1] - jdm_get(J, i2, j1);
+
+    long max_k = x1 < x2 ? x1 : x2;
+    if (avail12 < max_k) max_k = avail12;
+    if (avail21 < max_k) max_k = avail21;
+    return max_k > 0 ? max_k : 0;
+}
+
+// Verifica preliminare: esiste almeno uno swap eseguibile?
+// Esaustiva (O(ncand^2)) fino a PRECHECK_MAX candidati, oltre si affida
+// al campionatore con tentativi limitati.
+#define PRECHECK_MAX 4096
+static int feasibility_precheck(const Jdm *J) {
+    if (J->ncand < 2) {
+        fprintf(stderr, "No feasible swap: only %zu off-diagonal cell(s) with count >= 2 "
+                        "(need at least 2 disjoint ones)\n", J->ncand);
+        return 0;
+    }
+    if (J->ncand > PRECHECK_MAX) return 1;
+    for (size_t a = 0; a < J->ncand; a++)
+        for (size_t b = a + 1; b < J->ncand; b++)
+            if (swap_capacity(J, (long)J->cand[a], (long)J->cand[b]) > 0 ||
+                swap_capacity(J, (long)J->cand[b], (long)J->cand[a]) > 0)
+                return 1;
+    fprintf(stderr, "No feasible swap: %zu candidate cells but no disjoint pair "
+                    "with spare capacity\n", J->ncand);
+    return 0;
+}
+
+// Una catena di mutazione indipendente
+typedef struct {
+    int id;               // indice della catena, -1 se è l'unica
+    const Jdm *base;      // JDM di partenza condivisa (sola lettura)
+    long num_steps;
+    long snap_every;      // 0 = nessuno snapshot intermedio
+    long max_attempts;    // tentativi consecutivi falliti prima di arrendersi
+    const char *outfile;
+    int write_threads;    // thread di formattazione per ogni scrittura
+    uint64_t seed;
+    int status;
+    // statistiche
+    long steps_done;
+    long attempts;        // coppie di celle pescate
+    long accepts;         // swap eseguiti (= steps_done)
+    long sum_k;           // somma delle unità spostate
+} Chain;
+
+// Esegue num_steps 2-edge-swap “disjoint” con controllo capacità su J.
+// Ogni passo prova al più max_attempts coppie: se nessuna è eseguibile
+// la catena si ferma in anticipo (ch->steps_done < num_steps).
+static void mutate(Chain *ch, Jdm *J, Rng *rng) {
+    for (long step = 0; step < ch->num_steps; step++) {
+        long c1, c2, c12, c21, max_k = 0, k;
+        long tries;
+
+        for (tries = 0; tries < ch->max_attempts && J->ncand >= 2; tries++) {
+            // (a) pescaggio di due celle off-diagonali (i<j) con J[i][j]>=2,
+            //     in O(1) dall'indice dei candidati
+            c1 = (long)J->cand[rng_below(rng, J->ncand)];
+            c2 = (long)J->cand[rng_below(rng, J->ncand)];
+            // (b)-(d) disjoint, capacità residue e max_k
+            max_k = swap_capacity(J, c1, c2);
+            if (max_k >= 1) break;
+        }
+        ch->attempts += tries + (max_k >= 1);
+        if (max_k < 1) return;
+
+        // (e) esegui lo swap
+        int i1 = J->cells[c1].d1, j1 = J->cells[c1].d2;
+        int i2 = J->cells[c2].d1, j2 = J->cells[c2].d2;
+        k = 1 + rng_below(rng, max_k);
+        c12 = jdm_get_or_add(J, i1, j2);
+        c21 = jdm_get_or_add(J, i2, j1);
+        jdm_add(J, c1, -k);
+        jdm_add(J, c2, -k);
+        jdm_add(J, c12, k);
+        jdm_add(J, c21, k);
+        // le celle azzerate escono dalla JDM sparsa (prima l'indice più alto,
+        // così lo spostamento dell'ultima cella non tocca l'altra)
+        long hi = c1 > c2 ? c1 : c2, lo = c1 > c2 ? c2 : c1;
+        if (J->cells[hi].count == 0) jdm_remove(J, hi);
+        if (J->cells[lo].count == 0) jdm_remove(J, lo);
+        ch->accepts++;
+        ch->sum_k += k;
+        ch->steps_done = step + 1;
+
+        // (f) snapshot intermedio ogni snap_every passi
+        if (ch->snap_every > 0 && (step + 1) % ch->snap_every == 0
+            && step + 1 < ch->num_steps) {
+            char *path = chain_path(ch->outfile, ch->id, step + 1);
+            if (jdm_write(J, path, ch->write_threads) != 0) ch->status = -1;
+            free(path);
+        }
+    }
+}
+
+// Riga di statistiche di una catena (o del totale, id = -1) su stderr
+static void report_stats(const char *label, long steps, long done,
+                         long attempts, long accepts, long sum_k) {
+    fprintf(stderr, "%s: steps=%ld/%ld attempts=%ld accepts=%ld acceptance=%.4f avg_k=%.3f%s\n",
+            label, done, steps, attempts, accepts,
+            attempts ? (double)accepts / attempts : 0.0,
+            accepts ? (double)sum_k / accepts : 0.0,
+            done < steps ? " STOPPED: no feasible swap found within the attempt limit" : "");
+}
+
+static void *chain_run(void *arg) {
+    Chain *ch = arg;
+    Jdm J;
+    jdm_copy(&J, ch->base);
+    Rng rng = { ch->seed };
+    mutate(ch, &J, &rng);
+
+    char *path = ch->id >= 0 ? chain_path(ch->outfile, ch->id, -1) : strdup(ch->outfile);
+    if (jdm_write(&J, path, ch->write_threads) != 0) ch->status = -1;
+    free(path);
+    jdm_free(&J);
+    return NULL;
+}
+
+// Pool di thread: ogni worker prende la prossima catena libera
+typedef struct {
+    Chain *chains;
+    int nchains;
+    int next;
+} ChainPool;
+
+static void *pool_worker(void *arg) {
+    ChainPool *pool = arg;
+    int c;
+    while ((c = __atomic_fetch_add(&pool->next, 1, __ATOMIC_RELAXED)) < pool->nchains)
+        chain_run(&pool->chains[c]);
+    return NULL;
+}
+
+#define DEFAULT_MAX_ATTEMPTS 1000000L
+
+static void usage(const char *prog) {
+    fprintf(stderr,
+            "Usage: %s [-c chains] [-t threads] [-S snap_every] [-s seed] [-a max_attempts]\n"
+            "          <input.nkk> <num_steps> <output.nkk>\n"
+            "  -c K  run K independent chains from the same input; chain i is\n"
+            "        written to <output>.c<i>.nkk (default 1: <output.nkk>)\n"
+            "  -t T  worker threads (default: online CPUs)\n"
+            "  -S S  also write a snapshot every S steps (<output>[.c<i>].s<step>.nkk)\n"
+            "  -s X  base seed; chain i uses an independent stream derived from X and i\n"
+            "  -a A  give up a chain after A consecutive infeasible draws (default %ld);\n"
+            "        its current state is still written and the exit status is 2\n",
+            prog, DEFAULT_MAX_ATTEMPTS);
+}
+
+// Punto d'ingresso anche per "jdm mutate" (vedi jdm.h)
+int jdm_mutate_main(int argc, char *argv[]) {
+    int nchains = 1;
+    long nthreads = sysconf(_SC_NPROCESSORS_ONLN);
+    long snap_every = 0;
+    long max_attempts = DEFAULT_MAX_ATTEMPTS;
+    int have_seed = 0;
+    uint64_t base_seed = 0;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "c:t:S:s:a:h")) != -1) {
+        switch (opt) {
+        case 'c': nchains = atoi(optarg); break;
+        case 't': nthreads = atol(optarg); break;
+        case 'S': snap_every = atol(optarg); break;
+        case 's': base_seed = strtoull(optarg, NULL, 10); have_seed = 1; break;
+        case 'a': max_attempts = atol(optarg); break;
+        default:  usage(argv[0]); return EXIT_FAILURE;
+        }
+    }
+    if (argc - optind != 3 || nchains < 1 || max_attempts < 1) {
+        usage(argv[0]);
         return EXIT_FAILURE;
     }
-    const char *infile  = argv[1];
-    long num_steps       = atol(argv[2]);
-    const char *outfile  = argv[3];
+    const char *infile  = argv[optind];
+    long num_steps       = atol(argv[optind + 1]);
+    const char *outfile  = argv[optind + 2];
+    if (nthreads < 1) nthreads = 1;
+    if (nthreads > nchains) nthreads = nchains;
 
-    // 1) Leggi tutte le entry da infile, in array per mantenere ordine
-    Entry *entries = NULL;
-    size_t cap = 0, nents = 0;
+    // 1) Leggi tutte le entry da infile nella JDM sparsa
+    //    ((k,l) e (l,k) finiscono nella stessa cella)
+    Jdm jdm = {0};
+    Jdm *J = &jdm;
     int maxd = 0;
+    jdm_rehash(J, 1024);
     {
         FILE *fin = fopen(infile, "r");
         if (!fin) { perror("open input"); return EXIT_FAILURE; }
@@ -34,105 +424,105 @@ int main(int argc, char *argv[]) {
         while (fgets(line, sizeof(line), fin)) {
             int d1, d2;
             long cnt;
-            if (sscanf(line, "%d,%d,%ld", &d1, &d2, &cnt) != 3) 
+            if (sscanf(line, "%d,%d,%ld", &d1, &d2, &cnt) != 3 || cnt == 0)
                 continue;
-            if ((size_t)nents == cap) {
-                cap = cap ? cap * 2 : 16;
-                entries = realloc(entries, cap * sizeof *entries);
-                if (!entries) { perror("realloc"); return EXIT_FAILURE; }
-            }
-            entries[nents++] = (Entry){d1, d2, cnt};
+            long c = jdm_get_or_add(J, d1, d2);
+            J->cells[c].count = cnt;
             if (d1 > maxd) maxd = d1;
             if (d2 > maxd) maxd = d2;
         }
         fclose(fin);
     }
 
-    int n = maxd + 1;
-    // 2) Costruisci matrice simmetrica J[n][n]
-    long **J = malloc(n * sizeof *J);
-    if (!J) { perror("malloc"); return EXIT_FAILURE; }
-    for (int i = 0; i < n; i++) {
-        J[i] = calloc(n, sizeof *J[i]);
-        if (!J[i]) { perror("calloc"); return EXIT_FAILURE; }
-    }
-    // Popola da entries[]
-    for (size_t i = 0; i < nents; i++) {
-        int d1 = entries[i].d1, d2 = entries[i].d2;
-        J[d1][d2] = entries[i].count;
-        J[d2][d1] = entries[i].count;
-    }
-
-    // 3) Semina RNG con microsecondi ^ PID
-    struct timeval tv;
-    gettimeofday(&tv, NULL);
-    unsigned seed = (unsigned)(tv.tv_sec ^ (tv.tv_usec << 10) ^ getpid());
-    srand(seed);
-
-    // 4) Mutazioni: 2-edge-swap “disjoint” con controllo capacità
-    for (long step = 0; step < num_steps; step++) {
-        int i1, j1, i2, j2;
-        long x1, x2, max_k, k;
-
-        do {
-            // (a) pescaggio di due archi (i<j) con J[i][j]>=2 e disjoint
-            do {
-                i1 = rand() % (n - 1);
-                j1 = i1 + 1 + rand() % (n - i1 - 1);
-                x1 = J[i1][j1];
-            } while (x1 < 2);
-
-            do {
-                i2 = rand() % (n - 1);
-                j2 = i2 + 1 + rand() % (n - i2 - 1);
-                x2 = J[i2][j2];
-            } while (
-                x2 < 2
-                || (i2==i1 && j2==j1)
-                || i2==i1 || i2==j1 || j2==i1 || j2==j1
-            );
-
-            // (b) calcola n_k per ogni grado coinvolto
-            long nk_i1 = row_sum(J,n,i1) / i1;
-            long nk_j1 = row_sum(J,n,j1) / j1;
-            long nk_i2 = row_sum(J,n,i2) / i2;
-            long nk_j2 = row_sum(J,n,j2) / j2;
-
-            // (c) capacità residue
-            long cap12    = (i1 != j2 ? nk_i1*nk_j2   : nk_i1*(nk_i1-1));
-            long cap21    = (i2 != j1 ? nk_i2*nk_j1   : nk_i2*(nk_i2-1));
-            long avail12  = cap12 - J[i1][j2];
-            long avail21  = cap21 - J[i2][j1];
-
-            // (d) determina max_k
-            max_k = x1 < x2 ? x1 : x2;
-            if (avail12 < max_k) max_k = avail12;
-            if (avail21 < max_k) max_k = avail21;
-
-        } while (max_k < 1);
+    // 2) Precalcola n_k una volta sola e costruisci l'indice dei candidati
+    int n = J->n = maxd + 1;
+    long *rows = calloc(n, sizeof *rows);
+    J->nk = calloc(n, sizeof *J->nk);
+    if (!rows || !J->nk) { perror("calloc"); return EXIT_FAILURE; }
+    for (size_t c = 0; c < J->ncells; c++) {
+        Cell *cell = &J->cells[c];
+        rows[cell->d1] += cell->count;
+        if (cell->d1 != cell->d2) rows[cell->d2] += cell->count;
+        long cnt = cell->count;
+        cell->count = 0;
+        jdm_add(J, (long)c, cnt);
+    }
+    for (int d = 1; d < n; d++) J->nk[d] = rows[d] / d;
+    free(rows);
+
+    // Verifica preliminare: senza swap eseguibili non si avviano le catene
+    if (num_steps > 0 && !feasibility_precheck(J)) {
+        jdm_free(J);
+        return EXIT_FAILURE;
+    }
 
-        // (e) esegui lo swap
-        k = 1 + rand() % max_k;
-        J[i1][j1] -= k;  J[j1][i1] -= k;
-        J[i2][j2] -= k;  J[j2][i2] -= k;
-        J[i1][j2] += k;  J[j2][i1] += k;
-        J[i2][j1] += k;  J[j1][i2] += k;
+    // 3) Seme di base: dato con -s oppure microsecondi ^ PID.
+    //    La catena i usa lo stream splitmix64 inizializzato da
+    //    mix(mix(base) ^ i * φ), con mix = un passo di splitmix64: il seme
+    //    di base è mescolato prima di aggiungere i, così la catena i+1 di -s X
+    //    non coincide con la catena i di -s X+1.
+    if (!have_seed) {
+        struct timeval tv;
+        gettimeofday(&tv, NULL);
+        base_seed = (uint64_t)tv.tv_sec ^ ((uint64_t)tv.tv_usec << 20) ^ ((uint64_t)getpid() << 40);
+    }
+
+    // 4) Mutazioni: nchains catene indipendenti su nthreads thread.
+    //    Le CPU che le catene lasciano libere formattano l'output: con una
+    //    catena per CPU ogni scrittura usa un solo thread, non ncpu per catena.
+    long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+    int write_threads = ncpu > nthreads ? (int)(ncpu / nthreads) : 1;
+    Chain *chains = calloc(nchains, sizeof *chains);
+    if (!chains) { perror("calloc"); return EXIT_FAILURE; }
+    for (int c = 0; c < nchains; c++) {
+        Rng mix = { base_seed };
+        mix.s = rng_next(&mix) ^ ((uint64_t)c * 0x9e3779b97f4a7c15ULL);
+        chains[c] = (Chain){ .id = nchains > 1 ? c : -1, .base = J,
+                             .num_steps = num_steps, .snap_every = snap_every,
+                             .max_attempts = max_attempts, .outfile = outfile,
+                             .write_threads = write_threads,
+                             .seed = rng_next(&mix) };
     }
+    ChainPool pool = { chains, nchains, 0 };
+    pthread_t *threads = malloc(nthreads * sizeof *threads);
+    if (!threads) { perror("malloc"); return EXIT_FAILURE; }
+    for (long t = 0; t < nthreads; t++)
+        if (pthread_create(&threads[t], NULL, pool_worker, &pool) != 0) {
+            perror("pthread_create");
+            return EXIT_FAILURE;
+        }
+    for (long t = 0; t < nthreads; t++)
+        pthread_join(threads[t], NULL);
 
-    // 5) Scrivi output **nello stesso ordine e stile** di input
-    FILE *fout = fopen(outfile, "w");
-    if (!fout) { perror("open output"); return EXIT_FAILURE; }
-    for (size_t i = 0; i < nents; i++) {
-        int d1 = entries[i].d1, d2 = entries[i].d2;
-        long cnt = J[d1][d2];
-        fprintf(fout, "%d,%d,%ld\n", d1, d2, cnt);
+    // 5) Esito: ogni catena ha scritto il proprio output (e gli snapshot).
+    //    Statistiche per catena e totali per tarare il numero di passi.
+    int status = EXIT_SUCCESS;
+    long tot_done = 0, tot_att = 0, tot_acc = 0, tot_k = 0;
+    for (int c = 0; c < nchains; c++) {
+        const Chain *ch = &chains[c];
+        char label[32];
+        snprintf(label, sizeof label, "chain %d", c);
+        if (nchains > 1)
+            report_stats(label, ch->num_steps, ch->steps_done, ch->attempts, ch->accepts, ch->sum_k);
+        tot_done += ch->steps_done;
+        tot_att  += ch->attempts;
+        tot_acc  += ch->accepts;
+        tot_k    += ch->sum_k;
+        if (ch->status != 0) status = EXIT_FAILURE;
+        else if (ch->steps_done < ch->num_steps && status == EXIT_SUCCESS) status = 2;
     }
-    fclose(fout);
+    report_stats("total", num_steps * nchains, tot_done, tot_att, tot_acc, tot_k);
 
     // 6) Pulizia
-    for (int i = 0; i < n; i++) free(J[i]);
-    free(J);
-    free(entries);
+    free(threads);
+    free(chains);
+    jdm_free(J);
 
-    return EXIT_SUCCESS;
+    return status;
+}
+
+#ifndef JDM_LIBRARY
+int main(int argc, char *argv[]) {
+    return jdm_mutate_main(argc, argv);
 }
+#endif
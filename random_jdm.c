@@ -1,12 +1,17 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
+#include <math.h>
+#include <unistd.h>
 #include <igraph.h>
 #include <glib.h>
+#include "jdm_io.h"
+#include "jdm.h"
 
 // Definizione di tipi per le strutture dati
-typedef GHashTable mapii;       // chiave: (int), valore: (int)
-typedef GHashTable mapi_mapii;  // chiave: (int), valore: (mapii*)
+typedef GHashTable mapii;       // chiave: grado, valore: conteggio (JDM_TO_POINTER)
+typedef GHashTable mapi_mapii;  // chiave: grado, valore: (mapii*)
 
 #ifndef GINT_TO_POINTER
 #define GINT_TO_POINTER(i)  ((gpointer)(glong)(i))
@@ -20,7 +25,9 @@ typedef GHashTable mapi_mapii;  // chiave: (int), valore: (mapii*)
    - Per ogni nodo calcola il grado d.
    - Per ogni arco (u,v), incrementa nkk[d(u)][d(v)] e nkk[d(v)][d(u)].
    - Restituisce un nuovo GHashTable (mapi_mapii).
+   In libjdm.a la stessa funzione è fornita da compare_jdm.c.
    ------------------------------------------------------------------------ */
+#ifndef JDM_LIBRARY
 mapi_mapii* compute_jdm_from_igraph(const igraph_t *g) {
     igraph_integer_t n = igraph_vcount(g);
 
@@ -44,22 +51,22 @@ mapi_mapii* compute_jdm_from_igraph(const igraph_t *g) {
         int deg_v = (int) igraph_vector_int_get(&deg, v);
 
         // Aggiorna nkk[deg_u][deg_v]
-        mapii *mapU = g_hash_table_lookup(result, GINT_TO_POINTER(deg_u));
+        mapii *mapU = g_hash_table_lookup(result, JDM_TO_POINTER(deg_u));
         if (!mapU) {
             mapU = g_hash_table_new(g_direct_hash, g_direct_equal);
-            g_hash_table_insert(result, GINT_TO_POINTER(deg_u), mapU);
+            g_hash_table_insert(result, JDM_TO_POINTER(deg_u), mapU);
         }
-        int oldValUV = GPOINTER_TO_INT(g_hash_table_lookup(mapU, GINT_TO_POINTER(deg_v)));
-        g_hash_table_insert(mapU, GINT_TO_POINTER(deg_v), GINT_TO_POINTER(oldValUV + 1));
+        intptr_t oldValUV = JDM_FROM_POINTER(g_hash_table_lookup(mapU, JDM_TO_POINTER(deg_v)));
+        g_hash_table_insert(mapU, JDM_TO_POINTER(deg_v), JDM_TO_POINTER(oldValUV + 1));
 
         // Aggiorna nkk[deg_v][deg_u]
-        mapii *mapV = g_hash_table_lookup(result, GINT_TO_POINTER(deg_v));
+        mapii *mapV = g_hash_table_lookup(result, JDM_TO_POINTER(deg_v));
         if (!mapV) {
             mapV = g_hash_table_new(g_direct_hash, g_direct_equal);
-            g_hash_table_insert(result, GINT_TO_POINTER(deg_v), mapV);
+            g_hash_table_insert(result, JDM_TO_POINTER(deg_v), mapV);
         }
-        int oldValVU = GPOINTER_TO_INT(g_hash_table_lookup(mapV, GINT_TO_POINTER(deg_u)));
-        g_hash_table_insert(mapV, GINT_TO_POINTER(deg_u), GINT_TO_POINTER(oldValVU + 1));
+        intptr_t oldValVU = JDM_FROM_POINTER(g_hash_table_lookup(mapV, JDM_TO_POINTER(deg_u)));
+        g_hash_table_insert(mapV, JDM_TO_POINTER(deg_u), JDM_TO_POINTER(oldValVU + 1));
 
         IGRAPH_EIT_NEXT(eit);
     }
@@ -68,65 +75,413 @@ mapi_mapii* compute_jdm_from_igraph(const igraph_t *g) {
     igraph_vector_int_destroy(&deg);
     return result;
 }
+#endif
 
 /* ------------------------------------------------------------------------
-   write_jdm(nkk)
-   - Stampa tutte le coppie (k,l) in formato "k,l,valore".
+   write_jdm(fp, nkk)
+   - Raccoglie tutte le coppie (k,l) e le stampa ordinate per (k,l)
+     in formato "k,l,valore" (convenzione canonica di jdm_io.h), con un
+     thread di formattazione per CPU.
+   - nkk è già simmetrica: ogni arco incrementa sia [k][l] che [l][k].
+   - Restituisce 0 se la JDM è stata scritta tutta su fp.
    ------------------------------------------------------------------------ */
-void write_jdm(mapi_mapii *nkk) {
-    // Itera su k (chiavi esterne)
+int write_jdm(FILE *fp, mapi_mapii *nkk) {
+    size_t n_rows = 0;
     GHashTableIter outer;
     gpointer key_k, val_k;
     g_hash_table_iter_init(&outer, nkk);
+    while (g_hash_table_iter_next(&outer, &key_k, &val_k))
+        n_rows += g_hash_table_size((mapii*) val_k);
+
+    JdmRow *rows = malloc((n_rows ? n_rows : 1) * sizeof *rows);
+    if (!rows) {
+        fprintf(stderr, "Errore: impossibile allocare %zu righe JDM\n", n_rows);
+        exit(EXIT_FAILURE);
+    }
+
+    // Itera su k (chiavi esterne) e su l (chiavi interne)
+    size_t idx = 0;
+    g_hash_table_iter_init(&outer, nkk);
     while (g_hash_table_iter_next(&outer, &key_k, &val_k)) {
-        int k = GPOINTER_TO_INT(key_k);
+        long k = JDM_FROM_POINTER(key_k);
         mapii *mapKL = (mapii*) val_k;
 
-        // Per ogni l interno, stampa "k,l,valore"
         GHashTableIter inner;
         gpointer key_l, val_l;
         g_hash_table_iter_init(&inner, mapKL);
         while (g_hash_table_iter_next(&inner, &key_l, &val_l)) {
-            int l = GPOINTER_TO_INT(key_l);
-            int val = GPOINTER_TO_INT(val_l);
-            printf("%d,%d,%d\n", k, l, val);
+            rows[idx].k = k;
+            rows[idx].l = JDM_FROM_POINTER(key_l);
+            rows[idx].value = JDM_FROM_POINTER(val_l);
+            idx++;
         }
     }
+
+    long n_threads = sysconf(_SC_NPROCESSORS_ONLN);
+    int err = jdm_write_rows(fp, rows, n_rows, n_threads > 0 ? (int) n_threads : 1);
+    if (fflush(fp) != 0) err = 1;
+    free(rows);
+    return err;
 }
 
 /* ------------------------------------------------------------------------
-   main(n, p):
-   1. Crea un grafo random Erdős–Rényi G(n,p) (non diretto, senza loop).
-   2. Calcola la JDM di questo grafo.
-   3. Stampa la JDM in righe "k,l,valore".
+   sample_powerlaw(kmin, gamma, kmax)
+   - Estrae un valore continuo da una Pareto con esponente gamma e
+     minimo kmin, troncata a kmax: inversione della CDF ristretta a
+     [kmin, kmax], così la massa oltre kmax si ridistribuisce su tutta la
+     coda invece di accumularsi sul valore kmax.
    ------------------------------------------------------------------------ */
-int main(int argc, char *argv[]) {
-    if (argc < 3) {
-        fprintf(stderr, "Uso: %s <n> <p>\n", argv[0]);
+static double sample_powerlaw(double kmin, double gamma, double kmax) {
+    if (kmax <= kmin) return kmax;
+    double a = gamma - 1.0;
+    double f_max = 1.0 - pow(kmax / kmin, -a);  // CDF in kmax
+    double u = igraph_rng_get_unif01(igraph_rng_default());
+    double x = kmin * pow(1.0 - u * f_max, -1.0 / a);
+    return x > kmax ? kmax : x;  // solo arrotondamento
+}
+
+/* ------------------------------------------------------------------------
+   powerlaw_kmin(avg_k, gamma)
+   - Minimo della Pareto che dà media avg_k: kmin = avg_k (gamma-2)/(gamma-1).
+   ------------------------------------------------------------------------ */
+static double powerlaw_kmin(double avg_k, double gamma) {
+    double kmin = avg_k * (gamma - 2.0) / (gamma - 1.0);
+    return kmin < 1.0 ? 1.0 : kmin;
+}
+
+/* ------------------------------------------------------------------------
+   powerlaw_weights(w, n, avg_k, gamma, kmax)
+   - Riempie w con n valori power-law (esponente gamma) di media avg_k e
+     nessuno oltre kmax: riscala verso la somma avg_k * n e ritaglia a kmax
+     finché la somma non torna (i valori ritagliati restano a kmax, gli
+     altri crescono a ogni giro).
+   - Se avg_k * n supera n * kmax la media si ferma sotto avg_k.
+   ------------------------------------------------------------------------ */
+#define POWERLAW_SCALE_ROUNDS 64
+
+static void powerlaw_weights(double *w, int n, double avg_k, double gamma, double kmax) {
+    double kmin = powerlaw_kmin(avg_k, gamma);
+    double target = avg_k * n, S = 0.0;
+    for (int i = 0; i < n; i++) {
+        w[i] = sample_powerlaw(kmin, gamma, kmax);
+        S += w[i];
+    }
+    for (int r = 0; r < POWERLAW_SCALE_ROUNDS && S > 0.0 && fabs(S - target) > 1e-9 * target; r++) {
+        double scale = target / S;
+        S = 0.0;
+        for (int i = 0; i < n; i++) {
+            w[i] = fmin(w[i] * scale, kmax);
+            S += w[i];
+        }
+    }
+}
+
+static int cmp_double_desc(const void *a, const void *b) {
+    double x = *(const double *) a, y = *(const double *) b;
+    return (x < y) - (x > y);
+}
+
+/* ------------------------------------------------------------------------
+   generate_chung_lu(g, n, avg_k, gamma, kmax)
+   - Pesi attesi w_i power-law di media avg_k e al massimo kmax
+     (powerlaw_weights).
+   - Ogni coppia (u,v) è collegata con probabilità min(w_u w_v / S, 1).
+   - Usa il salto geometrico di Miller–Hagberg sui pesi ordinati:
+     costo O(n + m) invece di O(n^2).
+   ------------------------------------------------------------------------ */
+static void generate_chung_lu(igraph_t *g, int n, double avg_k, double gamma, double kmax) {
+    double *w = malloc(n * sizeof *w);
+    if (!w) { fprintf(stderr, "Errore: impossibile allocare i pesi Chung-Lu\n"); exit(EXIT_FAILURE); }
+
+    powerlaw_weights(w, n, avg_k, gamma, kmax);
+    double S = 0.0;
+    for (int i = 0; i < n; i++) S += w[i];
+    qsort(w, n, sizeof *w, cmp_double_desc);
+
+    igraph_vector_int_t edges;
+    igraph_vector_int_init(&edges, 0);
+    for (int u = 0; u < n - 1; u++) {
+        int v = u + 1;
+        double p = fmin(w[u] * w[v] / S, 1.0);
+        while (v < n && p > 0.0) {
+            if (p != 1.0) {
+                double r = 1.0 - igraph_rng_get_unif01(igraph_rng_default());
+                v += (int) floor(log(r) / log(1.0 - p));
+            }
+            if (v < n) {
+                double q = fmin(w[u] * w[v] / S, 1.0);
+                if (igraph_rng_get_unif01(igraph_rng_default()) < q / p) {
+                    igraph_vector_int_push_back(&edges, u);
+                    igraph_vector_int_push_back(&edges, v);
+                }
+                p = q;
+                v++;
+            }
+        }
+    }
+    igraph_create(g, &edges, n, IGRAPH_UNDIRECTED);
+    igraph_vector_int_destroy(&edges);
+    free(w);
+}
+
+/* ------------------------------------------------------------------------
+   generate_configuration(g, n, avg_k, gamma, kmax)
+   - Sequenza di gradi interi power-law: pesi di media avg_k e al massimo
+     kmax (powerlaw_weights) arrotondati in modo stocastico, così la media
+     attesa resta avg_k; somma resa pari.
+   - Configuration model seguito da rimozione di loop e archi multipli:
+     gli hub perdono qualche arco, ma la coda resta quella richiesta.
+   ------------------------------------------------------------------------ */
+static void generate_configuration(igraph_t *g, int n, double avg_k, double gamma, double kmax) {
+    igraph_vector_int_t deg;
+    igraph_vector_int_init(&deg, n);
+
+    double *w = malloc(n * sizeof *w);
+    if (!w) { fprintf(stderr, "Errore: impossibile allocare i gradi\n"); exit(EXIT_FAILURE); }
+    powerlaw_weights(w, n, avg_k, gamma, kmax);
+    long sum = 0;
+    for (int i = 0; i < n; i++) {
+        double fl = floor(w[i]);
+        int d = (int) fl + (igraph_rng_get_unif01(igraph_rng_default()) < w[i] - fl);
+        if (d < 1) d = 1;
+        VECTOR(deg)[i] = d;
+        sum += d;
+    }
+    // La somma dei gradi deve essere pari
+    if (sum % 2 != 0) {
+        if (VECTOR(deg)[0] < kmax) VECTOR(deg)[0]++;
+        else VECTOR(deg)[0]--;
+    }
+    free(w);
+
+    igraph_degree_sequence_game(g, &deg, NULL, IGRAPH_DEGSEQ_CONFIGURATION);
+    igraph_simplify(g, /*multiple=*/1, /*loops=*/1, NULL);
+    igraph_vector_int_destroy(&deg);
+}
+
+/* ------------------------------------------------------------------------
+   generate_barabasi(g, n, avg_k, gamma)
+   - Attaccamento preferenziale lineare con m = avg_k/2 archi per nodo
+     e attrattività A: P(v) ∝ d(v) + A, da cui gamma = 3 + A/m.
+   - Esponenti gamma < 3 non sono raggiungibili con A > 0: si usa A = 1.
+   ------------------------------------------------------------------------ */
+static void generate_barabasi(igraph_t *g, int n, double avg_k, double gamma) {
+    int m = (int) lround(avg_k / 2.0);
+    if (m < 1) m = 1;
+    double A = m * (gamma - 3.0);
+    if (A < 1.0) {
+        if (gamma < 3.0)
+            fprintf(stderr, "Attenzione: BA non supporta gamma < 3, uso gamma ~ 3\n");
+        A = 1.0;
+    }
+    igraph_barabasi_game(g, n, /*power=*/1.0, m, NULL, /*outpref=*/1, A,
+                         IGRAPH_UNDIRECTED, IGRAPH_BARABASI_PSUMTREE, NULL);
+}
+
+/* Chiave di un arco non diretto (u < v) per la tabella degli archi. */
+#define EDGE_KEY(u, v) \
+    GSIZE_TO_POINTER((u) < (v) ? ((gsize)(u) << 32) | (gsize)(v) \
+                               : ((gsize)(v) << 32) | (gsize)(u))
+
+/* ------------------------------------------------------------------------
+   rewire_assortative(g, r, rounds)
+   - Riconnessione di Xulvi-Brunet–Sokolov che preserva i gradi.
+   - Ad ogni passo sceglie due archi (a,b), (c,d) su quattro nodi distinti:
+     con probabilità |r| li riconnette in modo ordinato per grado
+     (r > 0: alto-alto e basso-basso; r < 0: alto-basso), altrimenti
+     in modo casuale. Lo scambio è scartato se crea archi già presenti.
+   - Esegue rounds * m tentativi; |r| regola l'assortatività finale.
+   ------------------------------------------------------------------------ */
+static void rewire_assortative(igraph_t *g, double r, int rounds) {
+    igraph_integer_t n = igraph_vcount(g);
+    igraph_integer_t m = igraph_ecount(g);
+    if (m < 2) return;
+
+    igraph_vector_int_t deg, el;
+    igraph_vector_int_init(&deg, n);
+    igraph_degree(g, &deg, igraph_vss_all(), IGRAPH_ALL, IGRAPH_NO_LOOPS);
+    igraph_vector_int_init(&el, 0);
+    igraph_get_edgelist(g, &el, 0);
+
+    GHashTable *edge_set = g_hash_table_new(g_direct_hash, g_direct_equal);
+    for (igraph_integer_t e = 0; e < m; e++)
+        g_hash_table_insert(edge_set, EDGE_KEY(VECTOR(el)[2*e], VECTOR(el)[2*e+1]), GINT_TO_POINTER(1));
+
+    double p = fabs(r);
+    long accepted = 0, attempts = (long) rounds * m;
+    for (long t = 0; t < attempts; t++) {
+        igraph_integer_t e1 = igraph_rng_get_integer(igraph_rng_default(), 0, m - 1);
+        igraph_integer_t e2 = igraph_rng_get_integer(igraph_rng_default(), 0, m - 1);
+        igraph_integer_t x[4] = { VECTOR(el)[2*e1], VECTOR(el)[2*e1+1],
+                                  VECTOR(el)[2*e2], VECTOR(el)[2*e2+1] };
+        if (x[0] == x[2] || x[0] == x[3] || x[1] == x[2] || x[1] == x[3])
+            continue;
+
+        igraph_integer_t a, b, c, d;
+        if (igraph_rng_get_unif01(igraph_rng_default()) < p) {
+            // Ordina i quattro nodi per grado decrescente (insertion sort)
+            for (int i = 1; i < 4; i++)
+                for (int j = i; j > 0 && VECTOR(deg)[x[j]] > VECTOR(deg)[x[j-1]]; j--) {
+                    igraph_integer_t tmp = x[j]; x[j] = x[j-1]; x[j-1] = tmp;
+                }
+            if (r > 0) { a = x[0]; b = x[1]; c = x[2]; d = x[3]; }
+            else       { a = x[0]; b = x[3]; c = x[1]; d = x[2]; }
+        } else if (igraph_rng_get_unif01(igraph_rng_default()) < 0.5) {
+            a = x[0]; b = x[3]; c = x[2]; d = x[1];
+        } else {
+            a = x[0]; b = x[2]; c = x[1]; d = x[3];
+        }
+
+        if (g_hash_table_contains(edge_set, EDGE_KEY(a, b)) ||
+            g_hash_table_contains(edge_set, EDGE_KEY(c, d)))
+            continue;
+
+        g_hash_table_remove(edge_set, EDGE_KEY(VECTOR(el)[2*e1], VECTOR(el)[2*e1+1]));
+        g_hash_table_remove(edge_set, EDGE_KEY(VECTOR(el)[2*e2], VECTOR(el)[2*e2+1]));
+        g_hash_table_insert(edge_set, EDGE_KEY(a, b), GINT_TO_POINTER(1));
+        g_hash_table_insert(edge_set, EDGE_KEY(c, d), GINT_TO_POINTER(1));
+        VECTOR(el)[2*e1] = a; VECTOR(el)[2*e1+1] = b;
+        VECTOR(el)[2*e2] = c; VECTOR(el)[2*e2+1] = d;
+        accepted++;
+    }
+    fprintf(stderr, "Riconnessione: %ld scambi accettati su %ld tentativi\n", accepted, attempts);
+
+    igraph_destroy(g);
+    igraph_create(g, &el, n, IGRAPH_UNDIRECTED);
+
+    g_hash_table_destroy(edge_set);
+    igraph_vector_int_destroy(&el);
+    igraph_vector_int_destroy(&deg);
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr,
+            "Uso: %s [opzioni] <n> [p]\n"
+            "  -m modello     er (default), cl (Chung-Lu), cm (configuration model),\n"
+            "                 ba (Barabasi-Albert)\n"
+            "  -k grado_medio grado medio atteso (default 4; per er si usa p se dato)\n"
+            "  -g gamma       esponente della coda power-law (default 2.5)\n"
+            "  -x grado_max   grado massimo per cl/cm (default n-1)\n"
+            "  -r assort      riconnessione assortativa in [-1,1] (default 0 = nessuna)\n"
+            "  -w giri        tentativi di riconnessione per arco (default 10)\n"
+            "  -s seme        seme del generatore (default: tempo corrente)\n",
+            prog);
+}
+
+/* ------------------------------------------------------------------------
+   gen_parse_args(argc, argv, gp)
+   - Legge le opzioni e gli argomenti posizionali "<n> [p]" in gp,
+     applicando i valori di default e i controlli di validità.
+   - Restituisce 0 se gli argomenti sono validi, 1 altrimenti.
+   ------------------------------------------------------------------------ */
+int gen_parse_args(int argc, char *argv[], GenParams *gp) {
+    gp->model = MODEL_ER;
+    gp->avg_k = 4.0;
+    gp->gamma = 2.5;
+    gp->kmax = -1.0;
+    gp->assort = 0.0;
+    gp->rounds = 10;
+    gp->seed = (unsigned long)time(NULL);
+
+    int opt;
+    while ((opt = getopt(argc, argv, "m:k:g:x:r:w:s:h")) != -1) {
+        switch (opt) {
+        case 'm':
+            if      (strcmp(optarg, "er") == 0) gp->model = MODEL_ER;
+            else if (strcmp(optarg, "cl") == 0) gp->model = MODEL_CL;
+            else if (strcmp(optarg, "cm") == 0) gp->model = MODEL_CM;
+            else if (strcmp(optarg, "ba") == 0) gp->model = MODEL_BA;
+            else { usage(argv[0]); return 1; }
+            break;
+        case 'k': gp->avg_k  = atof(optarg); break;
+        case 'g': gp->gamma  = atof(optarg); break;
+        case 'x': gp->kmax   = atof(optarg); break;
+        case 'r': gp->assort = atof(optarg); break;
+        case 'w': gp->rounds = atoi(optarg); break;
+        case 's': gp->seed   = strtoul(optarg, NULL, 10); break;
+        default:  usage(argv[0]); return 1;
+        }
+    }
+    if (optind >= argc || (gp->model == MODEL_ER && optind + 1 >= argc && gp->avg_k <= 0)) {
+        usage(argv[0]);
         return 1;
     }
 
-    int n = atoi(argv[1]);
-    double p = atof(argv[2]);
+    gp->n = atoi(argv[optind]);
+    if (gp->n < 2) {
+        fprintf(stderr, "Errore: servono almeno 2 nodi\n");
+        return 1;
+    }
+    gp->p = (optind + 1 < argc) ? atof(argv[optind + 1]) : gp->avg_k / (gp->n - 1);
+    if (gp->kmax <= 0 || gp->kmax > gp->n - 1) gp->kmax = gp->n - 1;
+    if (gp->model != MODEL_ER && gp->gamma <= 2.0) {
+        fprintf(stderr, "Errore: l'esponente gamma deve essere > 2\n");
+        return 1;
+    }
+    if (gp->assort < -1.0 || gp->assort > 1.0) {
+        fprintf(stderr, "Errore: l'assortatività deve essere in [-1,1]\n");
+        return 1;
+    }
+    return 0;
+}
 
+/* ------------------------------------------------------------------------
+   generate_graph(gp, g)
+   - Inizializza i generatori casuali con gp->seed.
+   - Crea un grafo random non diretto e semplice secondo il modello scelto
+     (Erdős–Rényi G(n,p) di default, oppure Chung–Lu, configuration model
+     o Barabási–Albert con coda power-law).
+   - Se richiesto, lo riconnette verso l'assortatività voluta.
+   ------------------------------------------------------------------------ */
+void generate_graph(const GenParams *gp, igraph_t *g) {
     // Seed per il generatore di numeri casuali di igraph e di C
-    srand((unsigned)time(NULL));
-    igraph_rng_seed(igraph_rng_default(), (unsigned long)time(NULL));
+    srand((unsigned)gp->seed);
+    igraph_rng_seed(igraph_rng_default(), gp->seed);
+
+    switch (gp->model) {
+    case MODEL_ER:
+        igraph_erdos_renyi_game(g,
+                                IGRAPH_ERDOS_RENYI_GNP,
+                                gp->n,  // numero di nodi
+                                gp->p,  // probabilità di edge
+                                IGRAPH_UNDIRECTED,
+                                IGRAPH_NO_LOOPS);
+        break;
+    case MODEL_CL: generate_chung_lu(g, gp->n, gp->avg_k, gp->gamma, gp->kmax);      break;
+    case MODEL_CM: generate_configuration(g, gp->n, gp->avg_k, gp->gamma, gp->kmax); break;
+    case MODEL_BA: generate_barabasi(g, gp->n, gp->avg_k, gp->gamma);                break;
+    }
+    // Grado medio ottenuto: loop e archi multipli rimossi lo abbassano (cm),
+    // un kmax troppo basso non lascia raggiungere avg_k
+    double mean = 2.0 * (double) igraph_ecount(g) / gp->n;
+    double want = gp->model == MODEL_ER ? gp->p * (gp->n - 1) : gp->avg_k;
+    fprintf(stderr, "Grado medio: %.3f (richiesto %.3f)\n", mean, want);
+
+    if (gp->assort != 0.0)
+        rewire_assortative(g, gp->assort, gp->rounds);
+}
+
+/* ------------------------------------------------------------------------
+   random_jdm_main([opzioni] n [p]):
+   1. Genera il grafo random (generate_graph).
+   2. Calcola la JDM di questo grafo.
+   3. Stampa la JDM in righe "k,l,valore".
+   ------------------------------------------------------------------------ */
+int random_jdm_main(int argc, char *argv[]) {
+    GenParams gp;
+    if (gen_parse_args(argc, argv, &gp) != 0)
+        return 1;
 
-    // Costruisce il grafo G(n,p)
     igraph_t g;
-    igraph_erdos_renyi_game(&g,
-                            IGRAPH_ERDOS_RENYI_GNP,
-                            n,      // numero di nodi
-                            p,      // probabilità di edge
-                            IGRAPH_UNDIRECTED,
-                            IGRAPH_NO_LOOPS);
+    generate_graph(&gp, &g);
 
     // Calcola la JDM di questo grafo random
     mapi_mapii *nkk = compute_jdm_from_igraph(&g);
 
     // Stampa la JDM in formato "k,l,valore"
-    write_jdm(nkk);
+    int err = write_jdm(stdout, nkk);
+    if (err)
+        fprintf(stderr, "Errore: scrittura della JDM su stdout non riuscita\n");
 
     // Pulizia
     igraph_destroy(&g);
@@ -141,5 +496,11 @@ int main(int argc, char *argv[]) {
     }
     g_hash_table_destroy(nkk);
 
-    return 0;
+    return err ? 1 : 0;
+}
+
+#ifndef JDM_LIBRARY
+int main(int argc, char *argv[]) {
+    return random_jdm_main(argc, argv);
 }
+#endif